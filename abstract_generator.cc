@@ -33,8 +33,9 @@
 
 #include "abstract_generator.h"
 
-#include <set>
 #include <algorithm>
+#include <cstdlib>
+#include <cstring>
 
 // Static helper
 static bool StripSuffix(grpc::string *filename, const grpc::string &suffix) {
@@ -49,8 +50,44 @@ static bool StripSuffix(grpc::string *filename, const grpc::string &suffix) {
   return false;
 }
 
-// Static helper. "helloworld.proto" -> "helloworld"
-static grpc::string StripProto(grpc::string filename) {
+bool AbstractGenerator::IsUnary(
+    const grpc::protobuf::MethodDescriptor *method)
+{
+  return !method->client_streaming() && !method->server_streaming();
+}
+
+bool AbstractGenerator::IsServerStreaming(
+    const grpc::protobuf::MethodDescriptor *method)
+{
+  return !method->client_streaming() && method->server_streaming();
+}
+
+bool AbstractGenerator::IsClientStreaming(
+    const grpc::protobuf::MethodDescriptor *method)
+{
+  return method->client_streaming() && !method->server_streaming();
+}
+
+bool AbstractGenerator::IsBidiStreaming(
+    const grpc::protobuf::MethodDescriptor *method)
+{
+  return method->client_streaming() && method->server_streaming();
+}
+
+bool AbstractGenerator::HasMethod(
+    bool (*kind)(const grpc::protobuf::MethodDescriptor *)) const
+{
+  for (auto it = analysis->services().begin();
+      it != analysis->services().end(); ++it) {
+    for (int i = 0; i < (*it)->method_count(); ++i) {
+      if (kind((*it)->method(i))) return true;
+    }
+  }
+  return false;
+}
+
+// "helloworld.proto" -> "helloworld"
+grpc::string AbstractGenerator::StripProto(grpc::string filename) {
   if (!StripSuffix(&filename, ".protodevel")) {
     StripSuffix(&filename, ".proto");
   }
@@ -92,80 +129,94 @@ static grpc::string ClassName(const grpc::protobuf::Descriptor *descriptor) {
   return "::" + DotsToColons(outer_name) + StringReplace(inner_name, ".", "_");
 }
 
-grpc::string AbstractGenerator::GenerateHeaders() const
+// Static helper. Identifier unique to the message within a program, built
+// from its class name: ::foo::Bar_Baz --> foo_Bar_Baz
+static grpc::string MessageId(const grpc::protobuf::Descriptor *descriptor) {
+  return StringReplace(ClassName(descriptor).substr(2), "::", "_");
+}
+
+void AbstractGenerator::BindServiceVars(
+    const grpc::protobuf::ServiceDescriptor *service, vars_t &vars) const
 {
-  grpc::string output;
-  {
-    // scoped printer
-    Printer printer(&output);
+  vars["service_name"] = service->name();
+  vars["full_service_name"] = DotsToColons(service->full_name());
+  vars["proto_filename_without_ext"] = StripProto(service->file()->name());
+}
 
-    vars_t vars;
-    vars["proto_filename"] = file->name();
-    vars["proto_filename_without_ext"] = StripProto(file->name());
+void AbstractGenerator::BindMethodVars(
+    const grpc::protobuf::MethodDescriptor *method, vars_t &vars) const
+{
+  vars["method_name"] = method->name();
+  vars["request_type"] = ClassName(method->input_type());
+  vars["response_type"] = ClassName(method->output_type());
+  vars["request_name"] = method->input_type()->name();
+  vars["request_id"] = MessageId(method->input_type());
+  vars["request_file_without_ext"] =
+      StripProto(method->input_type()->file()->name());
+  vars["response_name"] = method->output_type()->name();
+  vars["method_path"] =
+      "/" + method->service()->full_name() + "/" + method->name();
+}
 
-    PrintComment(printer, "Generated by the gRPC client protobuf plugin.");
-    PrintComment(printer, "If you make any local change, they will be lost.");
-    PrintComment(printer, vars, "source: $proto_filename$");
+void AbstractGenerator::PrintFileComment(Printer &printer, vars_t &vars) const
+{
+  vars["proto_filename"] = file->name();
+  vars["proto_filename_without_ext"] = StripProto(file->name());
 
-    printer.NewLine();
+  PrintComment(printer, "Generated by the gRPC client protobuf plugin.");
+  PrintComment(printer, "If you make any local change, they will be lost.");
+  PrintComment(printer, vars, "source: $proto_filename$");
 
-    DoPrintPackage(printer, vars);
-    DoPrintIncludes(printer, vars);
-    DoPrintFlags(printer, vars);
-  }
-  return output;
+  printer.NewLine();
 }
 
-static void RecursivlyTrackMessages(
-  const grpc::protobuf::Descriptor* message,
-  std::set<const grpc::protobuf::Descriptor*> &message_set)
+void AbstractGenerator::GenerateHeaders(Printer &printer) const
 {
-  // already tracking this method
-  if (message_set.find(message) != message_set.end())
-    return;
-
-  message_set.insert(message);
+  vars_t vars;
+  PrintFileComment(printer, vars);
 
-  for (int i = 0; i < message->field_count(); ++i) {
-    auto field = message->field(i);
-    if (field->type() == grpc::protobuf::FieldDescriptor::Type::TYPE_MESSAGE) {
-      RecursivlyTrackMessages(field->message_type(), message_set);
-    }
-  }
+  DoPrintPackage(printer, vars);
+  DoPrintIncludes(printer, vars);
+  DoPrintFlags(printer, vars);
 }
 
 void AbstractGenerator::PopulateEnum(
   const google::protobuf::EnumDescriptor* enum_,
-  Printer &printer, vars_t vars, bool repeated) const
+  Printer &printer, vars_t &vars, bool repeated) const
 {
+  vars_t::Scope scope(vars);
   const google::protobuf::EnumValueDescriptor* val = 
-      enum_->FindValueByNumber(0); // grabs first val of enum
+      enum_->FindValueByNumber(0); // grabs the default of proto3 enums
+  // proto2 enums need not have a zero value, take the first declared one
+  if (val == nullptr) val = enum_->value(0);
   vars["enum_type"] = DotsToColons(val->full_name());
   vars["enum_short_name"] = val->name();
-  grpc::string enum_type_upper = val->name();
+  vars["enum_number"] = std::to_string(val->number());
+  vars["enum_file_without_ext"] = StripProto(enum_->file()->name());
+  grpc::string &enum_type_upper = vars["upper_enum_type"];
+  enum_type_upper = val->name();
   std::transform(
       enum_type_upper.begin(), enum_type_upper.end(), enum_type_upper.begin(), toupper);
-  vars["upper_enum_type"] = enum_type_upper;
   vars["enum_name"] = enum_->name();
   DoPopulateEnum(printer, vars, repeated);
 }
 
-static grpc::string to_camel_case(const grpc::string &in)
+// Static helper. Writes into out so the caller can reuse its storage.
+static void to_camel_case(const grpc::string &in, grpc::string *out)
 {
-  grpc::string out;
+  out->clear();
   bool breaker = true;
-  for (int i = 0; i < in.length(); ++i) {
+  for (size_t i = 0; i < in.length(); ++i) {
     if (in[i] == '_') {
       breaker = true;
       continue;
     } else if (breaker) {
-      out.push_back(toupper(in[i]));
+      out->push_back(toupper(in[i]));
       breaker = false;
     } else {
-      out.push_back(in[i]);
+      out->push_back(in[i]);
     }
   }
-  return out;
 }
 
 void AbstractGenerator::PrintPopulateField(
@@ -173,14 +224,15 @@ void AbstractGenerator::PrintPopulateField(
   Printer &printer, vars_t &vars) const
 {
   vars["field_name"] = field->name();
-  std::string upper_field_name = field->name();
-  upper_field_name = to_camel_case(upper_field_name);
-  vars["camel_case_field_name"] = upper_field_name;
+  to_camel_case(field->name(), &vars["camel_case_field_name"]);
+  vars["field_number"] = std::to_string(field->number());
+  vars["field_type"] = std::to_string(field->type());
   bool repeated = field->is_repeated();
 
   if (field->type() == grpc::protobuf::FieldDescriptor::Type::TYPE_MESSAGE ||
       field->type() == grpc::protobuf::FieldDescriptor::Type::TYPE_GROUP) {
     vars["message_name"] = field->message_type()->name();
+    vars["message_id"] = MessageId(field->message_type());
     DoPopulateMessage(printer, vars, repeated);
   } else if (field->type() == grpc::protobuf::FieldDescriptor::Type::TYPE_ENUM) {
     PopulateEnum(field->enum_type(), printer, vars, repeated);
@@ -190,85 +242,86 @@ void AbstractGenerator::PrintPopulateField(
 }
 
 void AbstractGenerator::PrintMessagePopulatingFunction(
-    const grpc::protobuf::Descriptor *message, Printer &printer) const
+    const grpc::protobuf::Descriptor *message,
+    Printer &printer, vars_t &vars) const
 {
-  vars_t vars;
+  vars_t::Scope scope(vars);
   vars["message_type"] = ClassName(message);
   vars["message_name"] = message->name();
+  vars["message_id"] = MessageId(message);
   vars["proto_filename_without_ext"] = StripProto(file->name());
 
   PrintComment(printer, vars, "Helper function for populating $message_name$ message types.");
 
   DoPrintMessagePopulatingFunctionStart(printer, vars);
 
-  // some languages can't have empty function bodies. *cough cough* python.
-  if (!message->field_count()) DoEmptyMessage(printer, vars);
-
+  int populated = 0;
   for (int i = 0; i < message->field_count(); ++i) {
-    PrintPopulateField(message->field(i), printer, vars);
+    auto field = message->field(i);
+    if (analysis->IsRecursiveField(field)) {
+      // populating it would recurse forever
+      vars["field_name"] = field->name();
+      PrintComment(printer, vars, "Not populating recursive field $field_name$");
+      continue;
+    }
+    PrintPopulateField(field, printer, vars);
+    ++populated;
   }
 
+  // some languages can't have empty function bodies. *cough cough* python.
+  if (!populated) DoEmptyMessage(printer, vars);
+
   DoPrintMessagePopulatingFunctionEnd(printer);
   printer.NewLine();
 }
 
-grpc::string AbstractGenerator::GenerateMessagePopulationFunctions() const
+void AbstractGenerator::GenerateMessagePopulationFunctions(
+    Printer &printer) const
 {
-  // First we make sets of all of the message types needed
-  // by the input proto file.
-  std::set<const grpc::protobuf::Descriptor*> input_messages;
-  for (int i = 0; i < file->service_count(); ++i) {
-    auto service = file->service(i);
-    for (int j = 0; j < service->method_count(); ++j) {
-      auto method = service->method(j);
-      RecursivlyTrackMessages(method->input_type(), input_messages);
-    }
-  }
+  // The message types needed by the input proto file were collected by the
+  // analysis, each one after the messages it populates.
+  const std::vector<const grpc::protobuf::Descriptor*> &input_messages =
+      analysis->messages();
 
   // Print out helper functions for populating and printing message types
-  grpc::string output;
-  {
-    Printer printer(&output);
-
-    PrintComment(printer, "The following functions are utility functions for populating the various message types");
-    PrintComment(printer, "that are used by your service. They are to be used as examples, and then extended to");
-    PrintComment(printer, "implement your API specific prober logic");
-    printer.NewLine();
+  PrintComment(printer, "The following functions are utility functions for populating the various message types");
+  PrintComment(printer, "that are used by your service. They are to be used as examples, and then extended to");
+  PrintComment(printer, "implement your API specific prober logic");
+  printer.NewLine();
 
-    for (auto it = input_messages.begin(); 
-        it != input_messages.end(); ++it) {
-      PrintMessagePopulatingFunction(*it, printer);
-    }
-    printer.NewLine();
+  // one table for every message, so its slots are only allocated once
+  vars_t vars;
+  for (auto it = input_messages.begin(); 
+      it != input_messages.end(); ++it) {
+    PrintMessagePopulatingFunction(*it, printer, vars);
   }
-  return output;
+  printer.NewLine();
 }
 
 void AbstractGenerator::PrintMethodProbeFunction(
     const grpc::protobuf::MethodDescriptor *method,
     Printer &printer, vars_t &vars) const
 {
-  vars["method_name"] = method->name();
-  vars["request_type"] = ClassName(method->input_type());
-  vars["response_type"] = ClassName(method->output_type());
-  vars["request_name"] = method->input_type()->name();
-  vars["response_name"] = method->output_type()->name();
+  BindMethodVars(method, vars);
+
+  if (SupportsLoad() && IsUnary(method)) {
+    DoPrintMethodCallFunction(printer, vars);
+    printer.NewLine();
+  }
 
   DoPrintMethodProbeStart(printer, vars);
-  DoStartPrint(printer);
-  printer.Print(vars, "\\tProbing $method_name$...");
-  DoEndPrint(printer);
+  DoPrintMethodProbeHeading(printer, vars);
   printer.NewLine();
 
-  if (method->client_streaming() || method->server_streaming()) {
-    PrintComment(printer, "We do not support probing streaming methods at this time");
-    PrintComment(printer, "Please fill this function in which your own streaming specific logic");
-    PrintString(printer, vars, "\\t\\tStreaming not yet supported!!");
-    DoEndFunction(printer);
-    return;
-  } 
-
-  DoUnaryUnary(printer, vars);
+  if (IsServerStreaming(method)) {
+    DoUnaryStream(printer, vars);
+  } else if (IsClientStreaming(method)) {
+    DoStreamUnary(printer, vars);
+  } else if (IsBidiStreaming(method)) {
+    DoStreamStream(printer, vars);
+  } else {
+    DoUnaryUnary(printer, vars);
+  }
 
   DoEndFunction(printer);
 }
@@ -278,29 +331,54 @@ void AbstractGenerator::PrintMethodProbeCall(
     Printer &printer, vars_t &vars) const
 {
   vars["method_name"] = method->name();
+  DoPrintMethodProbeCall(printer, vars);
+}
+
+void AbstractGenerator::DoPrintMethodProbeHeading(
+    Printer &printer, vars_t &vars) const
+{
+  DoStartPrint(printer);
+  printer.Print(vars, "\\tProbing $method_name$...");
+  DoEndPrint(printer);
+}
+
+void AbstractGenerator::DoPrintServiceProbeHeading(
+    Printer &printer, vars_t &vars) const
+{
+  DoStartPrint(printer);
+  printer.Print(vars, "Probing $service_name$:");
+  DoEndPrint(printer);
+}
+
+void AbstractGenerator::DoPrintMethodProbeCall(
+    Printer &printer, vars_t &vars) const
+{
   printer.Print(vars, "Probe$service_name$$method_name$(stub);\n");
 }
 
-void AbstractGenerator::PrintServiceProbe(
-    const grpc::protobuf::ServiceDescriptor *service, Printer &printer) const
+void AbstractGenerator::DoPrintServiceProbeCall(
+    Printer &printer, vars_t &vars) const
 {
-  // dump in all interesting per-service info
-  vars_t vars;
-  vars["service_name"] = service->name();
-  vars["full_service_name"] = DotsToColons(service->full_name());
-  vars["proto_filename_without_ext"] = StripProto(file->name());
+  printer.Print(vars, "Probe$service_name$(channel);\n");
+}
 
-  // generate the method probing functions
-  for (int i = 0; i < service->method_count(); ++i) {
+void AbstractGenerator::PrintMethodProbeFunctions(
+    const grpc::protobuf::ServiceDescriptor *service, int begin, int end,
+    Printer &printer, vars_t &vars) const
+{
+  for (int i = begin; i < end; ++i) {
     PrintMethodProbeFunction(service->method(i), printer, vars);
     printer.NewLine();
   }
+}
 
+void AbstractGenerator::PrintServiceProbeFunction(
+    const grpc::protobuf::ServiceDescriptor *service,
+    Printer &printer, vars_t &vars) const
+{
   DoPrintServiceProbeStart(printer, vars);
 
-  DoStartPrint(printer);
-  printer.Print(vars, "Probing $service_name$:");
-  DoEndPrint(printer);
+  DoPrintServiceProbeHeading(printer, vars);
   printer.NewLine();
 
   DoCreateStub(printer, vars);
@@ -316,21 +394,49 @@ void AbstractGenerator::PrintServiceProbe(
   printer.NewLine();
 }
 
-grpc::string AbstractGenerator::GenerateServiceProbeFunctions() const
+void AbstractGenerator::PrintServiceLoadFunction(
+    const grpc::protobuf::ServiceDescriptor *service,
+    Printer &printer, vars_t &vars) const
+{
+  DoPrintServiceLoadStart(printer, vars);
+  for (int i = 0; i < service->method_count(); ++i) {
+    if (!IsUnary(service->method(i))) continue;
+    BindMethodVars(service->method(i), vars);
+    DoPrintLoadMethod(printer, vars);
+  }
+  DoEndFunction(printer);
+  printer.NewLine();
+}
+
+void AbstractGenerator::PrintServiceProbe(
+    const grpc::protobuf::ServiceDescriptor *service, Printer &printer) const
 {
-  grpc::string output;
-  {
-    Printer printer(&output);
+  // dump in all interesting per-service info
+  vars_t vars;
+  BindServiceVars(service, vars);
 
-    PrintComment(printer, "The following functions are responsible for probing the unary unary methods API.");
-    PrintComment(printer, "Hopefully it is easy to modify these functions to test you API specific logic.");
-    printer.NewLine();
+  // generate the method probing functions
+  PrintMethodProbeFunctions(service, 0, service->method_count(), printer, vars);
 
-    for (int i = 0; i < file->service_count(); ++i) {
-      PrintServiceProbe(file->service(i), printer);
-    }
+  PrintServiceProbeFunction(service, printer, vars);
+  if (SupportsLoad()) PrintServiceLoadFunction(service, printer, vars);
+}
+
+void AbstractGenerator::PrintServiceProbeComment(Printer &printer) const
+{
+  PrintComment(printer, "The following functions are responsible for probing the methods of the API.");
+  PrintComment(printer, "Hopefully it is easy to modify these functions to test you API specific logic.");
+  printer.NewLine();
+}
+
+void AbstractGenerator::GenerateServiceProbeFunctions(Printer &printer) const
+{
+  PrintServiceProbeComment(printer);
+
+  for (auto it = analysis->services().begin();
+      it != analysis->services().end(); ++it) {
+    PrintServiceProbe(*it, printer);
   }
-  return output;
 }
 
 void AbstractGenerator::PrintServiceProbeCall(
@@ -339,51 +445,211 @@ void AbstractGenerator::PrintServiceProbeCall(
   // dump in all interesting per-service info
   vars_t vars;
   vars["service_name"] = service->name();
-  printer.Print(vars, "Probe$service_name$(channel);\n");
+  DoPrintServiceProbeCall(printer, vars);
 }
 
-grpc::string AbstractGenerator::GenerateMain() const
+void AbstractGenerator::GenerateMain(Printer &printer) const
 {
-  grpc::string output;
-  {
-    Printer printer(&output);
-    DoStartMain(printer);
-    vars_t vars;
-    PrintString(printer, vars, "Prober started");
-    printer.NewLine();
-    DoParseFlags(printer);
-    printer.NewLine();
+  DoStartMain(printer);
+  vars_t vars;
+  PrintString(printer, vars, "Prober started");
+  printer.NewLine();
+  DoParseFlags(printer);
+  printer.NewLine();
 
-    PrintComment(printer, "The channel creating code is stored in the util directory.");
-    DoCreateChannel(printer);
+  PrintComment(printer, "The channel creating code is stored in the util directory.");
+  DoCreateChannel(printer);
 
-    for (int i = 0; i < file->service_count(); ++i) {
-      PrintServiceProbeCall(file->service(i), printer);
+  if (SupportsLoad()) {
+    DoPrintLoadStart(printer);
+    for (auto it = analysis->services().begin();
+        it != analysis->services().end(); ++it) {
+      BindServiceVars(*it, vars);
+      DoPrintServiceLoadCall(printer, vars);
     }
+    DoPrintLoadEnd(printer);
+  }
+
+  DoPrintProbesStart(printer);
+  for (auto it = analysis->services().begin();
+      it != analysis->services().end(); ++it) {
+    PrintServiceProbeCall(*it, printer);
+  }
+  DoPrintProbesEnd(printer);
+  printer.NewLine();
+  DoPrintLatencyReport(printer);
+  PrintString(printer, vars, "Prober finished");
+  DoPrintMainEnd(printer);
+  DoEndFunction(printer);
+}
+
+void AbstractGenerator::GenerateTrailer(Printer &printer) const
+{
+  DoTrailer(printer);
+}
+
+void AbstractGenerator::GenerateProberClient(Printer &printer) const
+{
+  GenerateHeaders(printer);
+  GenerateMessagePopulationFunctions(printer);
+  GenerateServiceProbeFunctions(printer);
+  GenerateMain(printer);
+  GenerateTrailer(printer);
+}
+
+void AbstractGenerator::GenerateSplitHeader(Printer &printer) const
+{
+  vars_t vars;
+  PrintFileComment(printer, vars);
+  DoPrintHeaderStart(printer, vars);
+
+  for (auto it = analysis->messages().begin();
+      it != analysis->messages().end(); ++it) {
+    vars["message_type"] = ClassName(*it);
+    vars["message_name"] = (*it)->name();
+    vars["message_id"] = MessageId(*it);
+    DoPrintMessagePopulatingFunctionDeclaration(printer, vars);
+  }
+  printer.NewLine();
+
+  for (auto it = analysis->services().begin();
+      it != analysis->services().end(); ++it) {
+    BindServiceVars(*it, vars);
+    for (int i = 0; i < (*it)->method_count(); ++i) {
+      vars["method_name"] = (*it)->method(i)->name();
+      if (SupportsLoad() && IsUnary((*it)->method(i))) {
+        DoPrintMethodCallDeclaration(printer, vars);
+      }
+      DoPrintMethodProbeDeclaration(printer, vars);
+    }
+    DoPrintServiceProbeDeclaration(printer, vars);
+    if (SupportsLoad()) DoPrintServiceLoadDeclaration(printer, vars);
     printer.NewLine();
-    PrintString(printer, vars, "Prober finished");
-    DoEndFunction(printer);
   }
-  return output;
+
+  DoPrintHeaderEnd(printer, vars);
 }
 
-grpc::string AbstractGenerator::GenerateTrailer() const
+void AbstractGenerator::GenerateSplitPreamble(Printer &printer) const
 {
-  grpc::string output;
-  {
-    Printer printer(&output);
-    DoTrailer(printer);
+  vars_t vars;
+  PrintFileComment(printer, vars);
+  DoPrintHeaderInclude(printer, vars);
+}
+
+bool AbstractGenerator::GenerateSplitProberClient(
+    grpc::protobuf::compiler::GeneratorContext *context,
+    grpc::string *error) const
+{
+  grpc::string base = GetProtoName();
+  grpc::string extension = GetLanguageSpecificFileExtension();
+
+  if (!PrintToFile(context, base + GetLanguageSpecificHeaderExtension(),
+                   [this](Printer &printer) { GenerateSplitHeader(printer); },
+                   error)) {
+    return false;
   }
-  return output;
+
+  if (!PrintToFile(context, base + "_populate" + extension,
+                   [this](Printer &printer) {
+                     GenerateSplitPreamble(printer);
+                     GenerateMessagePopulationFunctions(printer);
+                   }, error)) {
+    return false;
+  }
+
+  // one file per service, or per shard of methods_per_file methods. The
+  // service probe function goes into the last shard of its service.
+  for (auto it = analysis->services().begin();
+      it != analysis->services().end(); ++it) {
+    const grpc::protobuf::ServiceDescriptor *service = *it;
+    int count = service->method_count();
+    int per_file = options.methods_per_file > 0 ? options.methods_per_file
+                                                : std::max(count, 1);
+    int shards = std::max(1, (count + per_file - 1) / per_file);
+    for (int shard = 0; shard < shards; ++shard) {
+      grpc::string file_name = base + "_" + service->name();
+      if (shards > 1) file_name += "_" + std::to_string(shard);
+      int begin = shard * per_file;
+      int end = std::min(count, begin + per_file);
+      bool last = shard == shards - 1;
+      if (!PrintToFile(context, file_name + extension,
+                       [&](Printer &printer) {
+                         GenerateSplitPreamble(printer);
+                         PrintServiceProbeComment(printer);
+                         vars_t vars;
+                         BindServiceVars(service, vars);
+                         PrintMethodProbeFunctions(service, begin, end,
+                                                   printer, vars);
+                         if (last) {
+                           PrintServiceProbeFunction(service, printer, vars);
+                           if (SupportsLoad()) {
+                             PrintServiceLoadFunction(service, printer, vars);
+                           }
+                         }
+                       }, error)) {
+        return false;
+      }
+    }
+  }
+
+  return PrintToFile(context, base + "_main" + extension,
+                     [this](Printer &printer) {
+                       GenerateSplitPreamble(printer);
+                       vars_t vars;
+                       DoPrintFlags(printer, vars);
+                       GenerateMain(printer);
+                       GenerateTrailer(printer);
+                     }, error);
+}
+
+bool AbstractGenerator::PrintToFile(
+    grpc::protobuf::compiler::GeneratorContext *context,
+    const grpc::string &file_name,
+    const std::function<void(Printer &)> &print,
+    grpc::string *error) const
+{
+  std::unique_ptr<grpc::protobuf::io::ZeroCopyOutputStream> output(
+      context->Open(file_name));
+  // the printer must be flushed before the stream is released
+  Printer printer(output.get());
+  print(printer);
+  if (printer.failed()) {
+    *error = printer.error().empty() ? "Failed to write " + file_name
+                                     : printer.error();
+    return false;
+  }
+  return true;
 }
 
-grpc::string AbstractGenerator::GenerateProberClient() const
+bool AbstractGenerator::ParseOptions(const grpc::string &parameter,
+                                     grpc::string *error) const
 {
-  return GenerateHeaders()                    +
-         GenerateMessagePopulationFunctions() +
-         GenerateServiceProbeFunctions()      +
-         GenerateMain()                       +
-         GenerateTrailer();
+  options = Options();
+  std::vector<std::pair<grpc::string, grpc::string> > pairs;
+  grpc::protobuf::compiler::ParseGeneratorParameter(parameter, &pairs);
+  for (auto it = pairs.begin(); it != pairs.end(); ++it) {
+    if (it->first == "split_services") {
+      options.split_services = it->second != "false";
+    } else if (it->first == "methods_per_file") {
+      options.methods_per_file = atoi(it->second.c_str());
+      if (options.methods_per_file <= 0) {
+        *error = "methods_per_file must be a positive number: " + it->second;
+        return false;
+      }
+      options.split_services = true;
+    } else if (it->first == "populate_tables") {
+      options.populate_tables = it->second != "false";
+    } else if (it->first == "callback_api") {
+      options.callback_api = it->second != "false";
+    } else if (it->first == "arena") {
+      options.arena = it->second != "false";
+    } else {
+      *error = "Unknown generator option: " + it->first;
+      return false;
+    }
+  }
+  return true;
 }
 
 grpc::string AbstractGenerator::GetProtoName() const
@@ -411,22 +677,101 @@ void AbstractGenerator::PrintString(Printer &printer,
   DoEndPrint(printer);
 }
 
+void AbstractGenerator::Printer::Print(const vars_t &vars,
+                                       const char *string_template)
+{
+  const char *pos = string_template;
+  while (*pos != '\0') {
+    size_t literal = strcspn(pos, "$\n");
+    Write(pos, literal);
+    pos += literal;
+    if (*pos == '\n') {
+      NewLine();
+      ++pos;
+    } else if (*pos == '$') {
+      const char *end = strchr(pos + 1, '$');
+      if (end == nullptr) {
+        error_ = "Unterminated variable in template: ";
+        error_ += string_template;
+        return;
+      }
+      if (end == pos + 1) {
+        Write("$", 1);
+      } else {
+        const grpc::string *value = vars.Find(pos + 1, end - pos - 1);
+        if (value == nullptr) {
+          error_ = "Undefined variable in template: ";
+          error_.append(pos + 1, end - pos - 1);
+          return;
+        }
+        Write(value->data(), value->size());
+      }
+      pos = end + 1;
+    }
+  }
+}
+
+void AbstractGenerator::Printer::Print(const char *string)
+{
+  static const vars_t no_vars;
+  Print(no_vars, string);
+}
+
+void AbstractGenerator::Printer::Write(const char *data, size_t size)
+{
+  if (size == 0) return;
+  if (at_start_of_line_ && data[0] != '\n') {
+    printer_.WriteRaw(indent_.data(), indent_.size());
+    at_start_of_line_ = false;
+  }
+  printer_.WriteRaw(data, size);
+}
+
 // this function is called by the protobuf infrastructure when the protoc
-// binary is invoked with this plugin. It will call the internal generation
-// function, then write the generated output file
+// binary is invoked with this plugin. It analyses the file and generates
+// from that analysis.
 bool AbstractGenerator::Generate(const grpc::protobuf::FileDescriptor *file_,
                       const grpc::string &parameter,
                       grpc::protobuf::compiler::GeneratorContext *context,
                       grpc::string *error) const
 {
-  file = file_; // set member so children can access it
-  grpc::string generated_file = GenerateProberClient();
-  grpc::string file_name = GetProtoName() + GetLanguageSpecificFileExtension();
-  std::unique_ptr<grpc::protobuf::io::ZeroCopyOutputStream> client_output(
-      context->Open(file_name));
-  grpc::protobuf::io::CodedOutputStream client_coded_out(client_output.get());
-  client_coded_out.WriteRaw(generated_file.data(), generated_file.size());
-  return true;
+  ProtoAnalysis analysis_(file_);
+  return Generate(analysis_, parameter, context, error);
 }
 
+// Called instead of Generate when protoc is given several files. Generates
+// a single prober for all of them, named after the first one.
+bool AbstractGenerator::GenerateAll(
+    const std::vector<const grpc::protobuf::FileDescriptor *> &files,
+    const grpc::string &parameter,
+    grpc::protobuf::compiler::GeneratorContext *context,
+    grpc::string *error) const
+{
+  ProtoAnalysis analysis_(files);
+  return Generate(analysis_, parameter, context, error);
+}
 
+// Opens the output file(s) and streams every generation stage straight into
+// them.
+bool AbstractGenerator::Generate(const ProtoAnalysis &analysis_,
+                      const grpc::string &parameter,
+                      grpc::protobuf::compiler::GeneratorContext *context,
+                      grpc::string *error) const
+{
+  // set members so children can access them
+  analysis = &analysis_;
+  file = analysis_.file();
+  if (!ParseOptions(parameter, error)) return false;
+  if (!DoCheckAnalysis(error)) return false;
+
+  // languages without headers always get a single file
+  if (options.split_services &&
+      !GetLanguageSpecificHeaderExtension().empty()) {
+    return GenerateSplitProberClient(context, error);
+  }
+  return PrintToFile(context,
+                     GetProtoName() + GetLanguageSpecificFileExtension(),
+                     [this](Printer &printer) {
+                       GenerateProberClient(printer);
+                     }, error);
+}
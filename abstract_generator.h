@@ -37,43 +37,129 @@
  * logic.
  */
 
+#ifndef SRC_GENERATOR_ABSTRACT_GENERATOR_H
+#define SRC_GENERATOR_ABSTRACT_GENERATOR_H
+
+#include <functional>
+
 #include "config.h"
+#include "proto_analysis.h"
+#include "var_table.h"
 
-using vars_t = std::map<grpc::string, grpc::string>;
+using vars_t = VarTable;
 
 class AbstractGenerator : public grpc::protobuf::compiler::CodeGenerator {
  public:
 
   // this function is called by the protobuf infrastructure when the protoc
-  // binary is invoked with this plugin. It will call the internal generation
-  // function, then write the generated output file
+  // binary is invoked with this plugin. It opens the output file and streams
+  // every generation stage straight into it.
   bool Generate(const grpc::protobuf::FileDescriptor *file_,
                       const grpc::string &parameter,
                       grpc::protobuf::compiler::GeneratorContext *context,
                       grpc::string *error) const;
+
+  // Generates one prober for several files, and the messages they use
+  // from each other and from the files they import.
+  bool GenerateAll(
+      const std::vector<const grpc::protobuf::FileDescriptor *> &files,
+      const grpc::string &parameter,
+      grpc::protobuf::compiler::GeneratorContext *context,
+      grpc::string *error) const;
+
+  // Generates the prober from an analysis that was computed up front. The
+  // analysis may be shared with other generators running concurrently.
+  bool Generate(const ProtoAnalysis &analysis_,
+                      const grpc::string &parameter,
+                      grpc::protobuf::compiler::GeneratorContext *context,
+                      grpc::string *error) const;
  protected:
 
-  // Internal printing class
+  // Internal printing class. Writes directly into the output stream handed
+  // out by the GeneratorContext, so the generated file is never buffered as
+  // a whole in memory. Templates use the protobuf syntax: $var$ is replaced
+  // with the value bound in the VarTable and $$ prints a single $.
   class Printer {
    public:
-    Printer(grpc::string *str)
-        : output_stream_(str), printer_(&output_stream_, '$') {}
+    Printer(grpc::protobuf::io::ZeroCopyOutputStream *output)
+        : printer_(output, '$'), at_start_of_line_(true) {}
 
-    void Print(const vars_t &vars,
-               const char *string_template) {
-      printer_.Print(vars, string_template);
-    }
+    void Print(const vars_t &vars, const char *string_template);
 
-    void Print(const char *string) { printer_.Print(string); }
-    void NewLine() { printer_.Print("\n"); }
-    void Indent() { printer_.Indent(); }
-    void Outdent() { printer_.Outdent(); }
+    void Print(const char *string);
+    void NewLine() { Write("\n", 1); at_start_of_line_ = true; }
+    void Indent() { indent_ += "  "; }
+    void Outdent() {
+      if (indent_.size() >= 2) indent_.resize(indent_.size() - 2);
+    }
+    bool failed() const { return printer_.failed() || !error_.empty(); }
+    const grpc::string &error() const { return error_; }
 
    private:
-    grpc::protobuf::io::StringOutputStream output_stream_;
+    // writes raw bytes, inserting the indent at the start of a line
+    void Write(const char *data, size_t size);
+
     grpc::protobuf::io::Printer printer_;
+    grpc::string indent_;
+    bool at_start_of_line_;
+    grpc::string error_;
   };
 
+  // Options parsed from the protoc parameter, e.g.
+  // --grpc_out=split_services,methods_per_file=50:<out_dir>
+  struct Options {
+    Options()
+        : split_services(false),
+          methods_per_file(0),
+          populate_tables(false),
+          callback_api(false),
+          arena(false) {}
+
+    // emit a shared header, the population functions, one file per service
+    // and the main function as separate translation units. Only languages
+    // with a header extension support this.
+    bool split_services;
+    // when positive, services are sharded into files of at most this many
+    // methods. Implies split_services.
+    int methods_per_file;
+    // populate messages from compact generated tables instead of one
+    // straight-line function per message. Only used for C++.
+    bool populate_tables;
+    // make the calls through the callback API, with completions run by
+    // gRPC's own threads. Only used for C++.
+    bool callback_api;
+    // allocate the messages of every blocking call on a per-thread protobuf
+    // arena. Only used for C++.
+    bool arena;
+  };
+
+  // Set from the parameter by every call to Generate.
+  mutable Options options;
+
+  // "helloworld.proto" -> "helloworld"
+  static grpc::string StripProto(grpc::string filename);
+
+  static bool IsUnary(const grpc::protobuf::MethodDescriptor *method);
+  // a single request and a stream of responses
+  static bool IsServerStreaming(
+      const grpc::protobuf::MethodDescriptor *method);
+  // a stream of requests and a single response
+  static bool IsClientStreaming(
+      const grpc::protobuf::MethodDescriptor *method);
+  // streams both ways
+  static bool IsBidiStreaming(const grpc::protobuf::MethodDescriptor *method);
+
+  // Whether any service of the prober has a method of the given kind, for
+  // languages that may only import what they use.
+  bool HasMethod(
+      bool (*kind)(const grpc::protobuf::MethodDescriptor *)) const;
+
+  // Internal object representation of the first proto file, and the
+  // analysis of all of them. Need to be mutable so the const Generate
+  // method can set them.
+  mutable const grpc::protobuf::FileDescriptor *file;
+  mutable const ProtoAnalysis *analysis;
+
  private:
 
   // Printer helpers. Invokes the printer object with a concrete base
@@ -82,33 +168,69 @@ class AbstractGenerator : public grpc::protobuf::compiler::CodeGenerator {
   void PrintComment(Printer &printer, grpc::string str) const;
   void PrintString(Printer &printer, vars_t &vars, grpc::string str) const;
 
+  // Parses the protoc parameter into options. Fails on unknown options.
+  bool ParseOptions(const grpc::string &parameter, grpc::string *error) const;
+
+  // Opens file_name from the context and hands a printer streaming into it
+  // to print. Fails with the printer's error, if any.
+  bool PrintToFile(grpc::protobuf::compiler::GeneratorContext *context,
+                   const grpc::string &file_name,
+                   const std::function<void(Printer &)> &print,
+                   grpc::string *error) const;
+
+  // Binds the variables every per-service template uses.
+  void BindServiceVars(const grpc::protobuf::ServiceDescriptor *service,
+                       vars_t &vars) const;
+
+  // Binds the variables every per-method template uses.
+  void BindMethodVars(const grpc::protobuf::MethodDescriptor *method,
+                      vars_t &vars) const;
+
+  // Prints the "generated by" comment every output file starts with.
+  void PrintFileComment(Printer &printer, vars_t &vars) const;
+
   // Generates all of the includes and flags and constant variables.
-  grpc::string GenerateHeaders() const;
+  void GenerateHeaders(Printer &printer) const;
 
   // Generates all of the helper functions that populate all the
   // message types defined by the input proto(s)
-  grpc::string GenerateMessagePopulationFunctions() const;
+  void GenerateMessagePopulationFunctions(Printer &printer) const;
 
   // Generates probing functions for all of the services of a file.
-  grpc::string GenerateServiceProbeFunctions() const;
+  void GenerateServiceProbeFunctions(Printer &printer) const;
 
   // Generates the main function of the generated prober.
-  grpc::string GenerateMain() const;
+  void GenerateMain(Printer &printer) const;
 
   // Main generation function. Performs all logic that can be down with a
   // proto file. Delegates the language specific logic to the concrete
-  // base classes.
-  grpc::string GenerateProberClient() const;
+  // base classes. Every stage writes through the same printer.
+  void GenerateProberClient(Printer &printer) const;
+
+  // Generates the prober as several translation units: a header declaring
+  // every function, the population functions, one file per service (or
+  // per shard of a service) and the main function.
+  bool GenerateSplitProberClient(
+      grpc::protobuf::compiler::GeneratorContext *context,
+      grpc::string *error) const;
+
+  // Generates the header shared by the split translation units.
+  void GenerateSplitHeader(Printer &printer) const;
+
+  // Generates the comment and include every split translation unit
+  // starts with.
+  void GenerateSplitPreamble(Printer &printer) const;
 
   // Returns the name of the proto file, stripped of .proto
   grpc::string GetProtoName() const;
 
-  grpc::string GenerateTrailer() const;
+  void GenerateTrailer(Printer &printer) const;
 
   // prints a function responsible for populating and returning
   // the particular message type.
   void PrintMessagePopulatingFunction(
-    const grpc::protobuf::Descriptor *message, Printer &printer) const;
+    const grpc::protobuf::Descriptor *message,
+    Printer &printer, vars_t &vars) const;
 
   // prints a function that prints all items in a particular message.
   void PrintMessagePrintingFunction(
@@ -120,6 +242,24 @@ class AbstractGenerator : public grpc::protobuf::compiler::CodeGenerator {
       const grpc::protobuf::ServiceDescriptor *service,
       Printer &printer) const;
 
+  // Generates the probing functions of the methods in [begin, end).
+  void PrintMethodProbeFunctions(
+      const grpc::protobuf::ServiceDescriptor *service, int begin, int end,
+      Printer &printer, vars_t &vars) const;
+
+  // Generates only the function calling all of the method probes.
+  void PrintServiceProbeFunction(
+      const grpc::protobuf::ServiceDescriptor *service,
+      Printer &printer, vars_t &vars) const;
+
+  void PrintServiceProbeComment(Printer &printer) const;
+
+  // Generates the function registering the calls of a service's unary
+  // methods for load mode.
+  void PrintServiceLoadFunction(
+      const grpc::protobuf::ServiceDescriptor *service,
+      Printer &printer, vars_t &vars) const;
+
   void PrintServiceProbeCall(
       const grpc::protobuf::ServiceDescriptor *service,
       Printer &printer) const;
@@ -132,13 +272,11 @@ class AbstractGenerator : public grpc::protobuf::compiler::CodeGenerator {
     const grpc::protobuf::FieldDescriptor *field,
     Printer &printer, vars_t &vars) const;
 
-  // NOTE vars not by ref
-  void DeclareAndPopulateField(
-    const grpc::protobuf::Descriptor *message, 
-    Printer &printer, vars_t vars) const;
+  // binds the enum specific variables in a scope of their own, so they do
+  // not leak into the caller's table
   void PopulateEnum(
     const google::protobuf::EnumDescriptor *enum_, 
-    Printer &printer, vars_t vars, bool repeated) const;
+    Printer &printer, vars_t &vars, bool repeated) const;
 
   // Generates the function that probes a particular method.
   void PrintMethodProbeFunction(
@@ -180,6 +318,68 @@ class AbstractGenerator : public grpc::protobuf::compiler::CodeGenerator {
 
   // only used for Go, not pure virtual
   virtual void DoPrintPackage(Printer &printer, vars_t &vars) const {}
+  // Fails with error when the language cannot express the analysed files,
+  // before anything is printed. Not pure virtual.
+  virtual bool DoCheckAnalysis(grpc::string *error) const { return true; }
+
+  // Only used for C++, not pure virtual. These print the split output,
+  // which is disabled for languages returning an empty header extension.
+  virtual grpc::string GetLanguageSpecificHeaderExtension() const
+  {
+    return "";
+  }
+  // include guard, includes and flag declarations
+  virtual void DoPrintHeaderStart(Printer &printer, vars_t &vars) const {}
+  virtual void DoPrintHeaderEnd(Printer &printer, vars_t &vars) const {}
+  // includes the shared header from a split translation unit
+  virtual void DoPrintHeaderInclude(Printer &printer, vars_t &vars) const {}
+  virtual void DoPrintMessagePopulatingFunctionDeclaration(
+    Printer &printer, vars_t &vars) const {}
+  virtual void DoPrintServiceProbeDeclaration(
+    Printer &printer, vars_t &vars) const {}
+  virtual void DoPrintMethodProbeDeclaration(
+    Printer &printer, vars_t &vars) const {}
+
+  // Only used for C++, not pure virtual. In load mode the prober calls the
+  // unary methods from many threads, through functions making one call
+  // each that the services register with the load runner.
+  virtual bool SupportsLoad() const { return false; }
+  // one call of a unary method, returning its status
+  virtual void DoPrintMethodCallFunction(
+    Printer &printer, vars_t &vars) const {}
+  // start of the function registering a service's calls, ended with
+  // DoEndFunction
+  virtual void DoPrintServiceLoadStart(Printer &printer, vars_t &vars) const {}
+  virtual void DoPrintLoadMethod(Printer &printer, vars_t &vars) const {}
+  // in main, runs the load instead of the probes when it was asked for
+  virtual void DoPrintLoadStart(Printer &printer) const {}
+  virtual void DoPrintServiceLoadCall(Printer &printer, vars_t &vars) const {}
+  virtual void DoPrintLoadEnd(Printer &printer) const {}
+  virtual void DoPrintMethodCallDeclaration(
+    Printer &printer, vars_t &vars) const {}
+  virtual void DoPrintServiceLoadDeclaration(
+    Printer &printer, vars_t &vars) const {}
+
+  // Only used for C++, not pure virtual. Prints the latencies the probes
+  // recorded, at the end of main.
+  virtual void DoPrintLatencyReport(Printer &printer) const {}
+
+  // Not pure virtual. By default the probes print with DoStartPrint and
+  // run one after another: main calls every service's probe function,
+  // which calls those of its methods. C++ overrides these to run the
+  // method probes at the same time, handing them from the service probe
+  // functions to a runner that main waits for.
+  virtual void DoPrintServiceProbeHeading(Printer &printer,
+                                          vars_t &vars) const;
+  virtual void DoPrintMethodProbeHeading(Printer &printer,
+                                         vars_t &vars) const;
+  virtual void DoPrintMethodProbeCall(Printer &printer, vars_t &vars) const;
+  virtual void DoPrintServiceProbeCall(Printer &printer, vars_t &vars) const;
+  // around the service probe calls in main
+  virtual void DoPrintProbesStart(Printer &printer) const {}
+  virtual void DoPrintProbesEnd(Printer &printer) const {}
+  // Only used for C++, not pure virtual. The last statement of main.
+  virtual void DoPrintMainEnd(Printer &printer) const {}
 
   virtual void DoPrintIncludes(Printer &printer, vars_t &vars) const = 0;
   virtual void DoPrintFlags(Printer &printer, vars_t &vars) const = 0;
@@ -202,8 +402,17 @@ class AbstractGenerator : public grpc::protobuf::compiler::CodeGenerator {
 
   virtual void DoCreateStub(Printer &printer, vars_t &vars) const = 0;
   virtual void DoUnaryUnary(Printer &printer, vars_t &vars) const = 0;
-
-  // Internal object representation of the proto file.
-  // Needs to be mutable so the const Generate method can set it.
-  mutable const grpc::protobuf::FileDescriptor *file;
+  // Opens the stream with a populated request and drains it, reporting
+  // the time to the first message, the throughput and the gaps between
+  // messages.
+  virtual void DoUnaryStream(Printer &printer, vars_t &vars) const = 0;
+  // Sends the populated request over and over on the stream, as many
+  // messages or bytes as the flags ask for, then half-closes it and
+  // reports the upload throughput and how long the writes blocked.
+  virtual void DoStreamUnary(Printer &printer, vars_t &vars) const = 0;
+  // Plays ping-pong on one bidirectional stream: writes the populated
+  // request, waits for an answer and repeats, reporting the round trips.
+  virtual void DoStreamStream(Printer &printer, vars_t &vars) const = 0;
 };
+
+#endif  // SRC_GENERATOR_ABSTRACT_GENERATOR_H
@@ -0,0 +1,296 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Benchmarks the generators in-process on synthetic protos.
+ *
+ * Every generator is run through AbstractGenerator::Generate() against an
+ * in-memory GeneratorContext, on protos synthesized from the command line
+ * knobs below. Each run reports time, heap allocations and output bytes,
+ * and the complexity fit over the message counts flags superlinear growth.
+ *
+ *   generator_benchmark --messages=100,1000,10000 --fields=10 --depth=2 \
+ *       --enums=4 --services=2 --methods=16 [benchmark flags]
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <google/protobuf/descriptor.pb.h>
+
+#include "../cpp_generator.h"
+#include "../go_generator.h"
+#include "../python_generator.h"
+#include "allocation_counter.h"
+
+// Shape of the synthesized protos. messages is swept, the rest are fixed.
+struct CorpusOptions {
+  std::vector<int> messages = {100, 1000, 10000};
+  int fields = 10;
+  int depth = 2;
+  int enums = 4;
+  int services = 2;
+  int methods = 16;
+};
+
+// Keeps every generated file in memory, like protoc's plugin runner does.
+class MemoryGeneratorContext
+    : public grpc::protobuf::compiler::GeneratorContext {
+ public:
+  grpc::protobuf::io::ZeroCopyOutputStream *Open(
+      const grpc::string &filename) override {
+    return new google::protobuf::io::StringOutputStream(&files_[filename]);
+  }
+
+  size_t OutputBytes() const {
+    size_t bytes = 0;
+    for (auto it = files_.begin(); it != files_.end(); ++it) {
+      bytes += it->second.size();
+    }
+    return bytes;
+  }
+
+ private:
+  std::map<grpc::string, grpc::string> files_;
+};
+
+static const google::protobuf::FieldDescriptorProto::Type scalar_types[] = {
+    google::protobuf::FieldDescriptorProto::TYPE_INT32,
+    google::protobuf::FieldDescriptorProto::TYPE_STRING,
+    google::protobuf::FieldDescriptorProto::TYPE_DOUBLE,
+    google::protobuf::FieldDescriptorProto::TYPE_BOOL,
+    google::protobuf::FieldDescriptorProto::TYPE_INT64,
+    google::protobuf::FieldDescriptorProto::TYPE_BYTES,
+    google::protobuf::FieldDescriptorProto::TYPE_UINT32,
+    google::protobuf::FieldDescriptorProto::TYPE_FLOAT,
+};
+
+static void AddField(google::protobuf::DescriptorProto *message,
+                     const grpc::string &name,
+                     google::protobuf::FieldDescriptorProto::Type type,
+                     const grpc::string &type_name, bool repeated) {
+  google::protobuf::FieldDescriptorProto *field = message->add_field();
+  field->set_name(name);
+  field->set_number(message->field_size());
+  field->set_type(type);
+  if (!type_name.empty()) field->set_type_name(type_name);
+  field->set_label(repeated
+      ? google::protobuf::FieldDescriptorProto::LABEL_REPEATED
+      : google::protobuf::FieldDescriptorProto::LABEL_OPTIONAL);
+}
+
+// Fills message with scalar and enum fields, and a chain of depth nested
+// message types below it. full_name is the message's fully qualified name.
+static void FillMessage(google::protobuf::DescriptorProto *message,
+                        const grpc::string &full_name,
+                        const CorpusOptions &options, int depth) {
+  for (int i = 0; i < options.fields; ++i) {
+    std::ostringstream name;
+    name << "field_" << i;
+    if (options.enums > 0 && i % 4 == 3) {
+      std::ostringstream type_name;
+      type_name << ".bench.Enum" << i % options.enums;
+      AddField(message, name.str(),
+               google::protobuf::FieldDescriptorProto::TYPE_ENUM,
+               type_name.str(), i % 2 == 0);
+    } else {
+      AddField(message, name.str(), scalar_types[i % 8], "", i % 5 == 4);
+    }
+  }
+  if (depth > 0) {
+    google::protobuf::DescriptorProto *nested = message->add_nested_type();
+    nested->set_name("Nested");
+    FillMessage(nested, full_name + ".Nested", options, depth - 1);
+    AddField(message, "nested",
+             google::protobuf::FieldDescriptorProto::TYPE_MESSAGE,
+             "." + full_name + ".Nested", false);
+  }
+}
+
+// Builds bench.proto with the given number of top level messages. Message i
+// references message i + 1, so every message is reachable from Message0.
+static google::protobuf::FileDescriptorProto MakeCorpus(
+    const CorpusOptions &options, int num_messages) {
+  google::protobuf::FileDescriptorProto file;
+  file.set_name("bench.proto");
+  file.set_package("bench");
+  file.set_syntax("proto3");
+
+  for (int i = 0; i < options.enums; ++i) {
+    google::protobuf::EnumDescriptorProto *enum_ = file.add_enum_type();
+    std::ostringstream name;
+    name << "Enum" << i;
+    enum_->set_name(name.str());
+    for (int j = 0; j < 3; ++j) {
+      std::ostringstream value;
+      value << "ENUM" << i << "_VALUE" << j;
+      enum_->add_value()->set_name(value.str());
+      enum_->mutable_value(j)->set_number(j);
+    }
+  }
+
+  for (int i = 0; i < num_messages; ++i) {
+    std::ostringstream name;
+    name << "Message" << i;
+    google::protobuf::DescriptorProto *message = file.add_message_type();
+    message->set_name(name.str());
+    FillMessage(message, "bench." + name.str(), options, options.depth);
+    if (i + 1 < num_messages) {
+      std::ostringstream next;
+      next << ".bench.Message" << i + 1;
+      AddField(message, "next",
+               google::protobuf::FieldDescriptorProto::TYPE_MESSAGE,
+               next.str(), i % 3 == 0);
+    }
+  }
+
+  for (int i = 0; i < options.services; ++i) {
+    google::protobuf::ServiceDescriptorProto *service = file.add_service();
+    std::ostringstream name;
+    name << "Service" << i;
+    service->set_name(name.str());
+    for (int j = 0; j < options.methods; ++j) {
+      google::protobuf::MethodDescriptorProto *method = service->add_method();
+      std::ostringstream method_name, input;
+      method_name << "Method" << j;
+      input << ".bench.Message"
+            << (i * options.methods + j) * 7919 % num_messages;
+      method->set_name(method_name.str());
+      method->set_input_type(input.str());
+      method->set_output_type(".bench.Message0");
+    }
+  }
+  return file;
+}
+
+static void BM_Generate(benchmark::State &state,
+                        const AbstractGenerator *generator,
+                        const CorpusOptions *options) {
+  int num_messages = state.range(0);
+  google::protobuf::DescriptorPool pool;
+  const grpc::protobuf::FileDescriptor *file =
+      pool.BuildFile(MakeCorpus(*options, num_messages));
+  if (file == nullptr) {
+    state.SkipWithError("failed to build the synthetic proto");
+    return;
+  }
+
+  size_t total_allocations = 0;
+  size_t output_bytes = 0;
+  for (auto _ : state) {
+    MemoryGeneratorContext context;
+    grpc::string error;
+    size_t before = AllocationCount();
+    if (!generator->Generate(file, "", &context, &error)) {
+      state.SkipWithError(error.c_str());
+      return;
+    }
+    total_allocations += AllocationCount() - before;
+    output_bytes = context.OutputBytes();
+  }
+
+  state.SetComplexityN(num_messages);
+  state.SetBytesProcessed(state.iterations() * output_bytes);
+  state.counters["output_bytes"] = output_bytes;
+  state.counters["allocs"] = benchmark::Counter(
+      total_allocations, benchmark::Counter::kAvgIterations);
+  state.counters["allocs_per_msg"] = benchmark::Counter(
+      static_cast<double>(total_allocations) / num_messages,
+      benchmark::Counter::kAvgIterations);
+}
+
+// Parses a --name=value flag of ours, leaving unknown flags for benchmark.
+static bool ParseFlag(const char *arg, const char *name, grpc::string *value) {
+  size_t length = strlen(name);
+  if (strncmp(arg, "--", 2) != 0 || strncmp(arg + 2, name, length) != 0 ||
+      arg[2 + length] != '=') {
+    return false;
+  }
+  *value = arg + 3 + length;
+  return true;
+}
+
+int main(int argc, char **argv) {
+  CorpusOptions options;
+  int kept = 1;
+  for (int i = 1; i < argc; ++i) {
+    grpc::string value;
+    if (ParseFlag(argv[i], "messages", &value)) {
+      options.messages.clear();
+      std::istringstream counts(value);
+      grpc::string count;
+      while (std::getline(counts, count, ',')) {
+        options.messages.push_back(atoi(count.c_str()));
+      }
+    } else if (ParseFlag(argv[i], "fields", &value)) {
+      options.fields = atoi(value.c_str());
+    } else if (ParseFlag(argv[i], "depth", &value)) {
+      options.depth = atoi(value.c_str());
+    } else if (ParseFlag(argv[i], "enums", &value)) {
+      options.enums = atoi(value.c_str());
+    } else if (ParseFlag(argv[i], "services", &value)) {
+      options.services = atoi(value.c_str());
+    } else if (ParseFlag(argv[i], "methods", &value)) {
+      options.methods = atoi(value.c_str());
+    } else {
+      argv[kept++] = argv[i];
+    }
+  }
+  argc = kept;
+
+  std::vector<std::pair<const char *, std::unique_ptr<AbstractGenerator>>>
+      generators;
+  generators.emplace_back("cpp", NewCppGrpcClientGenerator());
+  generators.emplace_back("go", NewGoGrpcClientGenerator());
+  generators.emplace_back("python", NewPythonGrpcClientGenerator());
+
+  for (auto it = generators.begin(); it != generators.end(); ++it) {
+    grpc::string name = grpc::string("BM_Generate/") + it->first;
+    benchmark::internal::Benchmark *bm = benchmark::RegisterBenchmark(
+        name.c_str(), BM_Generate, it->second.get(), &options);
+    for (auto n = options.messages.begin(); n != options.messages.end(); ++n) {
+      bm->Arg(*n);
+    }
+    bm->Unit(benchmark::kMillisecond)->Complexity(benchmark::oAuto);
+  }
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,86 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Compares the per-call cost of the two ways generated C++ probers populate
+ * requests: the straight-line Populate<Message> functions and the tables
+ * emitted with the populate_tables option, walked by util/cpp. Both are the
+ * generator's output for FileDescriptorProto and the messages it reaches.
+ *
+ *   populate_benchmark [benchmark flags]
+ */
+
+#include <cstdio>
+
+#include <benchmark/benchmark.h>
+#include <google/protobuf/descriptor.pb.h>
+
+#include "../util/cpp/populate_message.h"
+
+#include "populate_straight_line.inc"
+#include "populate_tables.inc"
+
+static void BM_PopulateStraightLine(benchmark::State &state) {
+  while (state.KeepRunning()) {
+    google::protobuf::FileDescriptorProto message;
+    PopulateFileDescriptorProto(&message);
+    benchmark::DoNotOptimize(message);
+  }
+}
+BENCHMARK(BM_PopulateStraightLine);
+
+static void BM_PopulateTable(benchmark::State &state) {
+  while (state.KeepRunning()) {
+    google::protobuf::FileDescriptorProto message;
+    grpc::PopulateMessage(kPopulateFileDescriptorProto, &message);
+    benchmark::DoNotOptimize(message);
+  }
+}
+BENCHMARK(BM_PopulateTable);
+
+int main(int argc, char **argv) {
+  // the two modes must populate exactly the same values
+  google::protobuf::FileDescriptorProto straight_line, table;
+  PopulateFileDescriptorProto(&straight_line);
+  grpc::PopulateMessage(kPopulateFileDescriptorProto, &table);
+  if (straight_line.SerializeAsString() != table.SerializeAsString()) {
+    fprintf(stderr, "table population differs from the generated code:\n"
+                    "%s\nvs\n%s\n", straight_line.DebugString().c_str(),
+            table.DebugString().c_str());
+    return 1;
+  }
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,172 @@
+#!/usr/bin/env python2.7
+# Copyright 2017, Google Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met:
+#
+#     * Redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above
+# copyright notice, this list of conditions and the following disclaimer
+# in the documentation and/or other materials provided with the
+# distribution.
+#     * Neither the name of Google Inc. nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+"""
+Measures wall time and peak memory of generator plugins on large synthetic
+protos. Pass several plugin binaries (for example one built from an older
+revision) to compare them on the same inputs.
+
+The plugins are fed a serialized CodeGeneratorRequest directly on stdin, so
+the numbers only cover the plugin process and not protoc itself.
+"""
+
+from __future__ import print_function
+
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+def write_proto(path, num_messages, num_fields):
+  """Writes a proto with num_messages chained messages and one service."""
+  with open(path, "w") as proto:
+    proto.write("syntax = \"proto3\";\n\npackage streaming.bench;\n\n")
+    for i in range(num_messages):
+      proto.write("message Message%d {\n" % i)
+      for j in range(num_fields):
+        proto.write("  string field_%d = %d;\n" % (j, j + 1))
+      if i + 1 < num_messages:
+        proto.write("  Message%d next = %d;\n" % (i + 1, num_fields + 1))
+      proto.write("}\n\n")
+    proto.write("service BenchService {\n")
+    proto.write("  rpc Call(Message0) returns (Message0) {}\n")
+    proto.write("}\n")
+
+def read_varint(data, pos):
+  result = 0
+  shift = 0
+  while True:
+    byte = ord(data[pos:pos + 1])
+    pos += 1
+    result |= (byte & 0x7f) << shift
+    if not byte & 0x80:
+      return result, pos
+    shift += 7
+
+def write_varint(value):
+  out = bytearray()
+  while True:
+    byte = value & 0x7f
+    value >>= 7
+    if value:
+      out.append(byte | 0x80)
+    else:
+      out.append(byte)
+      return bytes(out)
+
+def make_request(proto_dir, proto_name):
+  """Builds a CodeGeneratorRequest from protoc's descriptor set output.
+
+  A FileDescriptorSet is a list of FileDescriptorProtos in field 1; a
+  CodeGeneratorRequest carries the same protos in field 15 next to the name
+  of the file to generate in field 1.
+  """
+  descriptor_set = os.path.join(proto_dir, "descriptor_set.pb")
+  subprocess.check_call(["protoc", "-I", proto_dir, "--include_imports",
+                         "--descriptor_set_out=" + descriptor_set, proto_name])
+  with open(descriptor_set, "rb") as f:
+    data = f.read()
+  request = bytearray()
+  request += write_varint((1 << 3) | 2)
+  request += write_varint(len(proto_name))
+  request += proto_name.encode("ascii")
+  pos = 0
+  while pos < len(data):
+    tag, pos = read_varint(data, pos)
+    length, pos = read_varint(data, pos)
+    assert tag == (1 << 3) | 2
+    request += write_varint((15 << 3) | 2)
+    request += write_varint(length)
+    request += data[pos:pos + length]
+    pos += length
+  return bytes(request)
+
+def run_plugin(plugin, request_path, output_path):
+  """Returns (seconds, peak rss in KiB, response bytes) for one run."""
+  with open(request_path, "rb") as stdin:
+    with open(output_path, "wb") as stdout:
+      start = time.time()
+      proc = subprocess.Popen(args=[plugin], stdin=stdin, stdout=stdout)
+      _, status, usage = os.wait4(proc.pid, 0)
+      elapsed = time.time() - start
+  if status:
+    print("ERROR: " + plugin + " failed")
+    raise SystemExit(1)
+  return elapsed, usage.ru_maxrss, os.path.getsize(output_path)
+
+argp = argparse.ArgumentParser(description='Benchmark generator plugins')
+argp.add_argument('--plugins',
+                  nargs='+',
+                  default=['bazel-bin/cpp_generator'],
+                  help='plugin binaries to compare')
+argp.add_argument('--messages',
+                  nargs='+',
+                  type=int,
+                  default=[1000, 5000, 20000],
+                  help='message counts of the synthetic protos')
+argp.add_argument('--fields',
+                  type=int,
+                  default=10,
+                  help='scalar fields per message')
+argp.add_argument('--runs',
+                  type=int,
+                  default=3,
+                  help='runs per plugin and size, the best one is reported')
+
+args = argp.parse_args()
+
+# ensure we run from the root dir of the repo
+ROOT = os.path.abspath(os.path.join(os.path.dirname(sys.argv[0]), ".."))
+os.chdir(ROOT)
+
+workdir = tempfile.mkdtemp()
+try:
+  print("%-40s %10s %10s %12s %14s" %
+        ("plugin", "messages", "seconds", "peak_rss_kb", "output_bytes"))
+  for num_messages in args.messages:
+    proto_name = "bench_%d.proto" % num_messages
+    write_proto(os.path.join(workdir, proto_name), num_messages, args.fields)
+    request_path = os.path.join(workdir, "request.pb")
+    with open(request_path, "wb") as f:
+      f.write(make_request(workdir, proto_name))
+    output_path = os.path.join(workdir, "response.pb")
+    for plugin in args.plugins:
+      results = [run_plugin(os.path.abspath(plugin), request_path, output_path)
+                 for _ in range(args.runs)]
+      elapsed = min(r[0] for r in results)
+      peak_rss = min(r[1] for r in results)
+      print("%-40s %10d %10.3f %12d %14d" %
+            (plugin[-40:], num_messages, elapsed,
+             peak_rss, results[0][2]))
+finally:
+  shutil.rmtree(workdir)
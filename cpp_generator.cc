@@ -0,0 +1,829 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <cctype>
+#include <memory>
+#include <sstream>
+#include <cstdlib>
+#include <map>
+
+#include "cpp_generator.h"
+
+static std::map<grpc::protobuf::FieldDescriptor::Type, grpc::string> sentinel_data {
+    {grpc::protobuf::FieldDescriptor::TYPE_DOUBLE, "1.234"},
+    {grpc::protobuf::FieldDescriptor::TYPE_FLOAT, "1.234"},
+    {grpc::protobuf::FieldDescriptor::TYPE_INT64, "1234"},
+    {grpc::protobuf::FieldDescriptor::TYPE_UINT64, "1234"},
+    {grpc::protobuf::FieldDescriptor::TYPE_INT32, "123"},
+    {grpc::protobuf::FieldDescriptor::TYPE_FIXED64, "1234"},
+    {grpc::protobuf::FieldDescriptor::TYPE_FIXED32, "123"},
+    {grpc::protobuf::FieldDescriptor::TYPE_BOOL, "true"},
+    {grpc::protobuf::FieldDescriptor::TYPE_STRING, "\"Hello world\""},
+    {grpc::protobuf::FieldDescriptor::TYPE_BYTES, "\"Hello world\""},
+    {grpc::protobuf::FieldDescriptor::TYPE_UINT32, "123"},
+    {grpc::protobuf::FieldDescriptor::TYPE_SFIXED32, "123"},
+    {grpc::protobuf::FieldDescriptor::TYPE_SFIXED64, "1234"},
+    {grpc::protobuf::FieldDescriptor::TYPE_SINT32, "123"},
+    {grpc::protobuf::FieldDescriptor::TYPE_SINT64, "1234"},
+};
+
+// Flags of the generated prober
+static const struct {
+  const char *type;
+  const char *name;
+  const char *default_value;
+  const char *help;
+} flags[] = {
+    {"bool", "use_tls", "false",
+     "Connection uses TLS if true, else plain TCP."},
+    {"bool", "use_test_ca", "false", "Client will use custom ca file."},
+    {"int32", "server_port", "8080", "Server port."},
+    {"string", "server_host", "\"localhost\"", "Server host to connect to"},
+    {"string", "server_host_override", "\"foo.test.google.fr\"",
+     "The server name use to verify the hostname returned by TLS handshake"},
+    {"int32", "probe_threads", "8",
+     "Threads probing the methods at the same time, 1 to probe them one "
+     "after another."},
+    {"int32", "concurrency", "0",
+     "Threads calling the unary methods in a closed loop, or calls in "
+     "flight for probers using the callback API. 0 probes every method once "
+     "instead. With --async, the number of completion queues, 0 for one per "
+     "core."},
+    {"double", "duration", "10",
+     "Seconds to run the load for, 0 for no limit."},
+    {"int64", "max_rpcs", "0",
+     "Stop the load after this many RPCs, 0 for no limit."},
+    {"bool", "async", "false",
+     "Run the load through the async API, with --outstanding_rpcs calls in "
+     "flight on each completion queue."},
+    {"int32", "outstanding_rpcs", "100",
+     "Calls each completion queue keeps in flight with --async."},
+    {"int32", "num_channels", "1",
+     "Channels, each with a connection of its own, to spread the load "
+     "and the streams of --bidi_throughput over."},
+    {"bool", "generic_stub", "false",
+     "Send each method's request serialized once through the generic stub, "
+     "and do not parse the responses. Uses the async API unless the prober "
+     "uses the callback API."},
+    {"double", "parse_sample_rate", "0",
+     "Fraction of the responses of --generic_stub to parse into the "
+     "method's response type, counting those that fail to parse."},
+    {"bool", "hash_responses", "false",
+     "Hash the responses of --generic_stub, to report whether they were all "
+     "the same."},
+    {"string", "scenario", "\"\"",
+     "File of the methods to load, one per line with its weight, a limit "
+     "of calls in flight and a deadline: <Service>/<Method> [weight=W] "
+     "[max_in_flight=N] [deadline_ms=D]. Each call picks its method at "
+     "random by weight."},
+    {"double", "target_qps", "0",
+     "Send this many RPCs per second whatever their latency, an open loop "
+     "through the async API. 0 runs a closed loop instead."},
+    {"bool", "poisson", "false",
+     "Space the sends of --target_qps as a Poisson process rather than "
+     "evenly."},
+    {"int32", "stream_messages", "10",
+     "Messages each client-streaming probe sends, unless --stream_bytes is "
+     "set, and round trips of each bidirectional streaming probe."},
+    {"int64", "stream_bytes", "0",
+     "Bytes each client-streaming probe sends, in whole messages. 0 sends "
+     "--stream_messages messages instead."},
+    {"int32", "stream_deadline_ms", "10000",
+     "Deadline of the stream of each bidirectional streaming probe, 0 for "
+     "none. A method leaving a message unanswered fails once it passed."},
+    {"bool", "bidi_throughput", "false",
+     "Probe bidirectional streaming methods for throughput instead of with "
+     "a ping-pong: write and read --bidi_streams streams per channel at "
+     "once for --duration seconds."},
+    {"int32", "bidi_streams", "1",
+     "Streams each channel opens to each method with --bidi_throughput."},
+};
+
+// Signatures of the generated functions, shared by their definitions and
+// the declarations in the split header.
+static const char populate_signature[] =
+    "void Populate$message_name$($message_type$ *message)";
+static const char populate_table_declaration[] =
+    "extern const grpc::PopulateField kPopulate$message_id$[]";
+static const char method_probe_signature[] =
+    "bool Probe$service_name$$method_name$("
+    "std::shared_ptr<$full_service_name$::Stub> stub, std::ostream &out)";
+static const char service_probe_signature[] =
+    "void Probe$service_name$(std::shared_ptr<grpc::Channel> channel, "
+    "grpc::ProbeRunner *probes)";
+static const char method_call_signature[] =
+    "grpc::Status Call$service_name$$method_name$("
+    "$full_service_name$::Stub *stub, grpc::ClientContext *context)";
+static const char service_load_signature[] =
+    "void Add$service_name$LoadMethods(std::shared_ptr<grpc::Channel> channel,"
+    " int channel_index, std::vector<grpc::LoadMethod> *methods)";
+
+class CppGrpcClientGenerator : public AbstractGenerator {
+ private:
+  grpc::string GetLanguageSpecificFileExtension() const 
+  { 
+    return ".grpc.client.pb.cc"; 
+  }
+
+  grpc::string GetLanguageSpecificHeaderExtension() const
+  {
+    return ".grpc.client.pb.h";
+  }
+
+  grpc::string GetCommentPrefix() const 
+  {
+    return "// "; 
+  }
+
+  void DoPrintPackage(Printer &printer, vars_t &vars) const
+  {
+    // nothing to do for c++
+  }
+
+  void DoPrintIncludes(Printer &printer, vars_t &vars) const
+  {
+    // headers
+    std::vector<grpc::string> headers = {
+        "chrono",
+        "iostream",
+        "memory",
+        "string",
+        "cstdint",
+        "thread",
+        "gflags/gflags.h",
+        "grpc++/grpc++.h",
+        "grpc/support/log.h",
+        "grpc/support/useful.h"};
+    if (options.callback_api) {
+      headers.insert(headers.begin() + 1, "future");
+    }
+
+    for (auto i = headers.begin(); i != headers.end(); i++) {
+      vars["header"] = *i;
+      printer.Print(vars, "#include <$header$>\n");
+    }
+
+    // the generated headers of every file include their imports
+    printer.NewLine();
+    for (auto it = analysis->files().begin(); it != analysis->files().end();
+         ++it) {
+      vars["include_file"] = StripProto((*it)->name());
+      printer.Print(vars, "#include \"$include_file$.grpc.pb.h\"\n");
+    }
+
+    printer.Print("\n#include \"../../util/cpp/create_prober_channel.h\"\n"
+                  "#include \"../../util/cpp/latency_histogram.h\"\n"
+                  "#include \"../../util/cpp/load_runner.h\"\n"
+                  "#include \"../../util/cpp/load_scenario.h\"\n"
+                  "#include \"../../util/cpp/probe_runner.h\"\n"
+                  "#include \"../../util/cpp/stream_stats.h\"\n");
+    if (!options.callback_api) {
+      printer.Print("#include \"../../util/cpp/duplex_streams.h\"\n");
+    }
+    if (options.callback_api) {
+      printer.Print("#include \"../../util/cpp/stream_reactors.h\"\n");
+    }
+    if (options.populate_tables) {
+      printer.Print("#include \"../../util/cpp/populate_message.h\"\n");
+    }
+    if (options.arena) {
+      printer.Print("#include \"../../util/cpp/call_arena.h\"\n");
+    }
+    printer.NewLine();
+  }
+
+  void PrintGflagsNamespaces(Printer &printer) const
+  {
+    printer.Print(
+      "// In some distros, gflags is in the namespace "
+      "google, and in some others,\n"
+      "// in gflags. This hack is enabling us to find both.\n"
+      "namespace google {}\n"
+      "namespace gflags {}\n"
+      "using namespace google;\n"
+      "using namespace gflags;\n\n");
+  }
+
+  // prints macro(name, ...) for every flag the prober takes, e.g.
+  // DEFINE_int32 for the definitions and DECLARE_int32 for the header
+  void PrintFlags(Printer &printer, vars_t &vars, bool define) const
+  {
+    for (size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); ++i) {
+      vars["flag_type"] = flags[i].type;
+      vars["flag_name"] = flags[i].name;
+      if (define) {
+        vars["flag_default"] = flags[i].default_value;
+        vars["flag_help"] = flags[i].help;
+        printer.Print(vars, "DEFINE_$flag_type$($flag_name$, $flag_default$, "
+                            "\"$flag_help$\");\n");
+      } else {
+        printer.Print(vars, "DECLARE_$flag_type$($flag_name$);\n");
+      }
+    }
+    printer.NewLine();
+  }
+
+  void DoPrintFlags(Printer &printer, vars_t &vars) const
+  {
+    PrintGflagsNamespaces(printer);
+
+    // print the flag definitions
+    PrintFlags(printer, vars, true);
+  }
+
+  void DoCreateChannel(Printer &printer) const
+  {
+    printer.Print(
+      "std::shared_ptr<grpc::Channel> channel = grpc::CreateProberChannel(\n"
+      "\t\tFLAGS_server_host, FLAGS_server_port, FLAGS_server_host_override,\n"
+      "\t\tFLAGS_use_tls, FLAGS_use_test_ca);\n\n");
+  }
+
+  void DoParseFlags(Printer &printer) const
+  {
+    printer.Print("ParseCommandLineFlags(&argc, &argv, true);\n"
+                  "if (FLAGS_num_channels <= 0) {\n"
+                  "  std::cerr << \"--num_channels must be positive\" << std::endl;\n"
+                  "  return 1;\n"
+                  "}\n");
+  }
+
+  void DoStartPrint(Printer &printer) const
+  {
+    printer.Print("std::cout << \"");
+  }
+
+  void DoEndPrint(Printer &printer) const
+  {
+    printer.Print("\" << std::endl;\n");
+  }
+
+  // With populate_tables, every message gets a constexpr table of its
+  // fields instead of a function, which util/cpp/populate_message walks.
+  // Trailing zero members are left out of the entries to keep them short.
+  void DoPrintMessagePopulatingFunctionStart(
+      Printer &printer, vars_t &vars) const
+  {
+    if (options.populate_tables) {
+      printer.Print(
+          vars, "constexpr grpc::PopulateField kPopulate$message_id$[] = {\n");
+    } else {
+      PrintSignature(printer, vars, populate_signature, " {\n");
+    }
+    printer.Indent();
+  }
+
+  void DoPrintMessagePopulatingFunctionEnd(Printer &printer) const
+  {
+    if (options.populate_tables) {
+      printer.Print("{}\n");
+      printer.Outdent();
+      printer.Print("};\n");
+    } else {
+      DoEndFunction(printer);
+    }
+  }
+
+
+  void DoPrintMethodProbeStart(Printer &printer, vars_t &vars) const
+  {
+    PrintSignature(printer, vars, method_probe_signature, " {\n");
+    printer.Indent();
+  }
+
+  void DoPrintServiceProbeStart(Printer &printer, vars_t &vars) const
+  {
+    PrintSignature(printer, vars, service_probe_signature, " {\n");
+    printer.Indent();
+  }
+
+  void PrintSignature(Printer &printer, vars_t &vars, const char *signature,
+                      const char *suffix) const
+  {
+    printer.Print(vars, signature);
+    printer.Print(suffix);
+  }
+
+  void DoPrintHeaderStart(Printer &printer, vars_t &vars) const
+  {
+    grpc::string guard = vars["proto_filename_without_ext"] +
+                         "_GRPC_CLIENT_PB_H";
+    for (size_t i = 0; i < guard.size(); ++i) {
+      guard[i] = isalnum(guard[i]) ? toupper(guard[i]) : '_';
+    }
+    vars["header_guard"] = guard;
+    printer.Print(vars, "#ifndef $header_guard$\n"
+                        "#define $header_guard$\n\n");
+
+    DoPrintIncludes(printer, vars);
+    PrintGflagsNamespaces(printer);
+    PrintFlags(printer, vars, false);
+  }
+
+  void DoPrintHeaderEnd(Printer &printer, vars_t &vars) const
+  {
+    printer.Print(vars, "#endif  // $header_guard$\n");
+  }
+
+  void DoPrintHeaderInclude(Printer &printer, vars_t &vars) const
+  {
+    printer.Print(vars, "#include \"$proto_filename_without_ext$"
+                        ".grpc.client.pb.h\"\n\n");
+  }
+
+  void DoPrintMessagePopulatingFunctionDeclaration(
+      Printer &printer, vars_t &vars) const
+  {
+    PrintSignature(printer, vars,
+                   options.populate_tables ? populate_table_declaration
+                                           : populate_signature,
+                   ";\n");
+  }
+
+  void DoPrintMethodProbeDeclaration(Printer &printer, vars_t &vars) const
+  {
+    PrintSignature(printer, vars, method_probe_signature, ";\n");
+  }
+
+  void DoPrintServiceProbeDeclaration(Printer &printer, vars_t &vars) const
+  {
+    PrintSignature(printer, vars, service_probe_signature, ";\n");
+  }
+
+  void DoCreateStub(Printer &printer, vars_t &vars) const
+  {
+    printer.Print(vars, "std::shared_ptr<$full_service_name$::Stub> stub =\n"
+                        "\t\t$full_service_name$::NewStub(channel);\n");
+  }
+
+  void DoPopulateField(Printer &printer, vars_t &vars, 
+      grpc::protobuf::FieldDescriptor::Type type, bool repeated) const
+  {
+    if (options.populate_tables) {
+      printer.Print(vars, repeated ? "{$field_number$, $field_type$, 2},\n"
+                                   : "{$field_number$, $field_type$},\n");
+      return;
+    }
+    vars["data"] = sentinel_data[type];
+    if (repeated) {
+      printer.Print(vars, "message->add_$field_name$($data$);\n");
+      printer.Print(vars, "message->add_$field_name$($data$);\n");
+    } else {
+      printer.Print(vars, "message->set_$field_name$($data$);\n");
+    }
+  }
+
+  void DoPopulateEnum(Printer &printer, vars_t &vars, bool repeated) const
+  {
+    if (options.populate_tables) {
+      vars["repeat"] = repeated ? "2" : "0";
+      printer.Print(vars, "{$field_number$, $field_type$, $repeat$, "
+                          "$enum_number$},\n");
+      return;
+    }
+    if (repeated) {
+      printer.Print(vars, "message->add_$field_name$($enum_type$);\n");
+      printer.Print(vars, "message->add_$field_name$($enum_type$);\n");
+    } else {
+      printer.Print(vars, "message->set_$field_name$($enum_type$);\n");
+    }
+  }
+
+  void DoPopulateMessage(Printer &printer, vars_t &vars, bool repeated) const
+  {
+    vars["mutable_or_add"] = repeated ? "add" : "mutable";
+    if (options.populate_tables) {
+      vars["repeat"] = repeated ? "2" : "0";
+      printer.Print(vars, "{$field_number$, $field_type$, $repeat$, 0, "
+                          "kPopulate$message_id$},\n");
+      return;
+    }
+    if (repeated) {
+      printer.Print(vars, "Populate$message_name$(message->add_$field_name$());\n");
+      printer.Print(vars, "Populate$message_name$(message->add_$field_name$());\n");
+    } else {
+      printer.Print(vars, "Populate$message_name$(message->mutable_$field_name$());\n");
+    }
+  }
+
+  void DoUnaryUnary(Printer &printer, vars_t &vars) const
+  {
+    printer.Print(vars,
+        "grpc::ClientContext context;\n"
+        "std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();\n"
+        "grpc::Status status = Call$service_name$$method_name$(stub.get(), &context);\n"
+        "grpc::RecordLatency(kLatency$service_name$$method_name$,\n"
+        "\t\tstd::chrono::steady_clock::now() - start);\n\n");
+    PrintStatusCheck(printer);
+    printer.Print("return true;\n");
+  }
+
+  void DoUnaryStream(Printer &printer, vars_t &vars) const
+  {
+    printer.Print(vars, "$request_type$ request;\n");
+    PrintPopulateRequest(printer, vars);
+    if (!options.callback_api) {
+      printer.Print(vars, "$response_type$ response;\n");
+    }
+    printer.Print("grpc::ClientContext context;\n\n"
+                  "grpc::StreamStats stats;\n");
+    if (options.callback_api) {
+      printer.Print(vars,
+          "grpc::ReadReactor<$response_type$> reactor(&stats);\n"
+          "stub->async()->$method_name$(&context, &request, &reactor);\n"
+          "reactor.Start();\n"
+          "grpc::Status status = reactor.Await();\n");
+    } else {
+      printer.Print(vars,
+          "std::unique_ptr<grpc::ClientReader<$response_type$>> reader(\n"
+          "\t\tstub->$method_name$(&context, request));\n"
+          "while (reader->Read(&response)) {\n"
+          "  stats.Record(response.ByteSizeLong());\n"
+          "}\n"
+          "grpc::Status status = reader->Finish();\n"
+          "stats.Finish();\n");
+    }
+    printer.Print(vars,
+        "grpc::PrintStreamStats(\"$service_name$/$method_name$\", stats, out);\n\n");
+    PrintStatusCheck(printer);
+    printer.Print("return true;\n");
+  }
+
+  void DoStreamUnary(Printer &printer, vars_t &vars) const
+  {
+    printer.Print(vars, "$request_type$ request;\n");
+    PrintPopulateRequest(printer, vars);
+    printer.Print(vars, "$response_type$ response;\n");
+    printer.Print("grpc::ClientContext context;\n\n"
+                  "grpc::WriteStats stats(FLAGS_stream_messages, FLAGS_stream_bytes);\n");
+    if (options.callback_api) {
+      printer.Print(vars,
+          "grpc::WriteReactor<$request_type$> reactor(request, &stats);\n"
+          "stub->async()->$method_name$(&context, &response, &reactor);\n"
+          "reactor.Start();\n"
+          "grpc::Status status = reactor.Await();\n");
+    } else {
+      printer.Print(vars,
+          "std::unique_ptr<grpc::ClientWriter<$request_type$>> writer(\n"
+          "\t\tstub->$method_name$(&context, &response));\n"
+          "// let the messages share frames, WritesDone flushes them\n"
+          "grpc::WriteOptions options;\n"
+          "options.set_buffer_hint();\n"
+          "const size_t size = request.ByteSizeLong();\n"
+          "while (stats.More()) {\n"
+          "  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();\n"
+          "  if (!writer->Write(request, options)) break;\n"
+          "  stats.Record(size, std::chrono::steady_clock::now() - start);\n"
+          "}\n"
+          "writer->WritesDone();\n"
+          "grpc::Status status = writer->Finish();\n"
+          "stats.Finish();\n");
+    }
+    printer.Print(vars,
+        "grpc::PrintWriteStats(\"$service_name$/$method_name$\", stats, out);\n\n");
+    PrintStatusCheck(printer);
+    printer.Print("return true;\n");
+  }
+
+  void DoStreamStream(Printer &printer, vars_t &vars) const
+  {
+    printer.Print(vars, "$request_type$ request;\n");
+    PrintPopulateRequest(printer, vars);
+    printer.NewLine();
+    PrintDuplexThroughput(printer, vars);
+    if (!options.callback_api) {
+      printer.Print(vars, "$response_type$ response;\n");
+    }
+    printer.Print("grpc::ClientContext context;\n"
+                  "if (FLAGS_stream_deadline_ms > 0) {\n"
+                  "  context.set_deadline(std::chrono::system_clock::now() +\n"
+                  "\t\tstd::chrono::milliseconds(FLAGS_stream_deadline_ms));\n"
+                  "}\n\n"
+                  "grpc::PingPongStats stats(FLAGS_stream_messages);\n");
+    if (options.callback_api) {
+      printer.Print(vars,
+          "grpc::PingPongReactor<$request_type$, $response_type$> reactor(request, &stats);\n"
+          "stub->async()->$method_name$(&context, &reactor);\n"
+          "reactor.Start();\n"
+          "grpc::Status status = reactor.Await();\n");
+    } else {
+      printer.Print(vars,
+          "std::unique_ptr<grpc::ClientReaderWriter<$request_type$, $response_type$>> stream(\n"
+          "\t\tstub->$method_name$(&context));\n"
+          "while (stats.More()) {\n"
+          "  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();\n"
+          "  if (!stream->Write(request)) break;\n"
+          "  if (!stream->Read(&response)) {\n"
+          "    stats.Unanswered();\n"
+          "    break;\n"
+          "  }\n"
+          "  stats.Record(std::chrono::steady_clock::now() - start);\n"
+          "}\n"
+          "stream->WritesDone();\n"
+          "// whatever else the server sends answers no message\n"
+          "while (stream->Read(&response)) {\n"
+          "  stats.Extra();\n"
+          "}\n"
+          "grpc::Status status = stream->Finish();\n"
+          "stats.Finish();\n");
+    }
+    printer.Print(vars,
+        "grpc::PrintPingPongStats(\"$service_name$/$method_name$\", stats, out);\n\n");
+    PrintStatusCheck(printer);
+    printer.Print("// PrintPingPongStats reported a method that is not one to one\n"
+                  "return stats.one_to_one();\n");
+  }
+
+  // Ends a probe on a failed status: reports it into the probe's output,
+  // where the runner prints it in order with the rest, and fails the
+  // probe instead of aborting the prober.
+  void PrintStatusCheck(Printer &printer) const
+  {
+    printer.Print(
+        "if (!status.ok()) {\n"
+        "  out << \"\\t\\tfailed: \" << status.error_code() << \" \"\n"
+        "      << status.error_message() << std::endl;\n"
+        "  return false;\n"
+        "}\n");
+  }
+
+  // Runs the method with --bidi_throughput instead of the ping-pong, on
+  // --bidi_streams streams per channel.
+  void PrintDuplexThroughput(Printer &printer, vars_t &vars) const
+  {
+    printer.Print("if (FLAGS_bidi_throughput) {\n");
+    printer.Indent();
+    printer.Print(vars,
+        "std::vector<std::shared_ptr<$full_service_name$::Stub>> stubs;\n"
+        "for (const std::shared_ptr<grpc::Channel> &channel : grpc::CreateProberChannels(\n"
+        "\t\tFLAGS_server_host, FLAGS_server_port, FLAGS_server_host_override,\n"
+        "\t\tFLAGS_use_tls, FLAGS_use_test_ca, FLAGS_num_channels)) {\n"
+        "  stubs.push_back($full_service_name$::NewStub(channel));\n"
+        "}\n");
+    if (options.callback_api) {
+      printer.Print(vars,
+          "grpc::DuplexStats stats = grpc::RunDuplexReactors<$request_type$, $response_type$>(\n"
+          "\t\trequest, stubs.size() * FLAGS_bidi_streams, FLAGS_duration,\n"
+          "\t\t[&stubs](size_t i, grpc::ClientContext *context,\n"
+          "\t\t\t\tgrpc::ClientBidiReactor<$request_type$, $response_type$> *reactor) {\n"
+          "\t\t\tstubs[i % stubs.size()]->async()->$method_name$(context, reactor);\n"
+          "\t\t});\n");
+    } else {
+      printer.Print(vars,
+          "grpc::DuplexStats stats = grpc::RunDuplexStreams<$request_type$, $response_type$>(\n"
+          "\t\trequest, stubs.size() * FLAGS_bidi_streams, FLAGS_duration,\n"
+          "\t\t[&stubs](size_t i, grpc::ClientContext *context) {\n"
+          "\t\t\treturn stubs[i % stubs.size()]->$method_name$(context);\n"
+          "\t\t});\n");
+    }
+    printer.Print(vars,
+        "grpc::PrintDuplexStats(\"$service_name$/$method_name$\", stats, out);\n\n"
+        "if (stats.failed() > 0) {\n"
+        "  out << \"\\t\\tfailed: \" << stats.failed() << \" of \" << stats.streams()\n"
+        "      << \" streams\" << std::endl;\n"
+        "  return false;\n"
+        "}\n"
+        "return true;\n");
+    printer.Outdent();
+    printer.Print("}\n\n");
+  }
+
+  // The service probe functions hand their method probes to a
+  // grpc::ProbeRunner, which runs them on --probe_threads threads and
+  // prints what each one wrote to out in order.
+  void DoPrintServiceProbeHeading(Printer &printer, vars_t &vars) const
+  {
+    printer.Print(vars, "probes->PrintLine(\"Probing $service_name$:\");\n");
+  }
+
+  void DoPrintMethodProbeHeading(Printer &printer, vars_t &vars) const
+  {
+    printer.Print(vars, "out << \"\\tProbing $method_name$...\" << std::endl;\n");
+  }
+
+  void DoPrintMethodProbeCall(Printer &printer, vars_t &vars) const
+  {
+    printer.Print(vars,
+        "probes->Add([stub](std::ostream &out) { "
+        "return Probe$service_name$$method_name$(stub, out); });\n");
+  }
+
+  void DoPrintServiceProbeCall(Printer &printer, vars_t &vars) const
+  {
+    printer.Print(vars, "Probe$service_name$(channel, &probes);\n");
+  }
+
+  void DoPrintProbesStart(Printer &printer) const
+  {
+    printer.Print("grpc::ProbeRunner probes(FLAGS_probe_threads, std::cout);\n");
+  }
+
+  void DoPrintProbesEnd(Printer &printer) const
+  {
+    printer.Print("probes.Wait();\n");
+  }
+
+  void DoPrintMainEnd(Printer &printer) const
+  {
+    printer.Print("return probes.failed() == 0 ? 0 : 1;\n");
+  }
+
+  void DoPrintLatencyReport(Printer &printer) const
+  {
+    printer.Print("std::cout << \"Latencies:\" << std::endl;\n"
+                  "grpc::PrintLatencies(std::cout);\n\n");
+  }
+
+  bool SupportsLoad() const { return true; }
+
+  void DoPrintMethodCallFunction(Printer &printer, vars_t &vars) const
+  {
+    // registered as the prober starts, so that the latency report lists
+    // the methods in order however the probes are scheduled
+    printer.Print(vars,
+        "static const int kLatency$service_name$$method_name$ =\n"
+        "\t\tgrpc::RegisterLatencyMethod(\"$service_name$/$method_name$\");\n\n");
+    PrintSignature(printer, vars, method_call_signature, " {\n");
+    printer.Indent();
+    if (options.arena) {
+      printer.Print(vars,
+          "grpc::CallArena arena;\n"
+          "$request_type$ &request = *arena.Create<$request_type$>();\n"
+          "$response_type$ &response = *arena.Create<$response_type$>();\n");
+    } else {
+      printer.Print(vars, "$request_type$ request;\n");
+      printer.Print(vars, "$response_type$ response;\n");
+    }
+    printer.NewLine();
+    PrintPopulateRequest(printer, vars);
+    printer.Print("\n");
+    if (options.callback_api) {
+      printer.Print(vars,
+          "std::promise<grpc::Status> done;\n"
+          "stub->async()->$method_name$(context, &request, &response,\n"
+          "\t\t[&done](grpc::Status status) { done.set_value(status); });\n"
+          "return done.get_future().get();\n");
+    } else {
+      printer.Print(vars, "return stub->$method_name$(context, request, &response);\n");
+    }
+    DoEndFunction(printer);
+  }
+
+  void PrintPopulateRequest(Printer &printer, vars_t &vars) const
+  {
+    if (options.populate_tables) {
+      printer.Print(vars,
+                    "grpc::PopulateMessage(kPopulate$request_id$, &request);\n");
+    } else {
+      printer.Print(vars, "Populate$request_name$(&request);\n");
+    }
+  }
+
+  void DoPrintServiceLoadStart(Printer &printer, vars_t &vars) const
+  {
+    PrintSignature(printer, vars, service_load_signature, " {\n");
+    printer.Indent();
+    DoCreateStub(printer, vars);
+  }
+
+  void DoPrintLoadMethod(Printer &printer, vars_t &vars) const
+  {
+    printer.Print("{\n");
+    printer.Indent();
+    printer.Print(vars, "$request_type$ request;\n");
+    PrintPopulateRequest(printer, vars);
+    printer.Print(vars,
+        "\ngrpc::LoadMethod method;\n"
+        "method.name = \"$service_name$/$method_name$\";\n"
+        "method.channel = channel_index;\n"
+        "method.call = [stub](grpc::ClientContext *context) {\n"
+        "\treturn Call$service_name$$method_name$(stub.get(), context);\n"
+        "};\n"
+        "method.new_async_call = grpc::AsyncUnaryCaller(\n"
+        "\t\tstub, &$full_service_name$::Stub::PrepareAsync$method_name$, request);\n"
+        "method.generic = grpc::GenericLoadCall(channel, \"$method_path$\", request,\n"
+        "\t\t$response_type$::default_instance());\n");
+    if (options.callback_api) {
+      printer.Print(vars,
+          "method.new_callback_call = grpc::CallbackUnaryCaller<$request_type$, $response_type$>(\n"
+          "\t\t[stub](grpc::ClientContext *context, const $request_type$ *request,\n"
+          "\t\t       $response_type$ *response, std::function<void(grpc::Status)> done) {\n"
+          "\t\t\tstub->async()->$method_name$(context, request, response, std::move(done));\n"
+          "\t\t}, request);\n");
+    }
+    printer.Print("methods->push_back(method);\n");
+    printer.Outdent();
+    printer.Print("}\n");
+  }
+
+  void DoPrintLoadStart(Printer &printer) const
+  {
+    printer.Print("if (FLAGS_concurrency > 0 || FLAGS_async || FLAGS_target_qps > 0 ||\n"
+                  "    FLAGS_generic_stub || !FLAGS_scenario.empty()) {\n");
+    printer.Indent();
+    printer.Print(
+        "std::vector<std::shared_ptr<grpc::Channel>> channels = grpc::CreateProberChannels(\n"
+        "\t\tFLAGS_server_host, FLAGS_server_port, FLAGS_server_host_override,\n"
+        "\t\tFLAGS_use_tls, FLAGS_use_test_ca, FLAGS_num_channels);\n"
+        "std::vector<grpc::LoadMethod> methods;\n"
+        "for (size_t i = 0; i < channels.size(); ++i) {\n");
+    printer.Indent();
+  }
+
+  void DoPrintServiceLoadCall(Printer &printer, vars_t &vars) const
+  {
+    printer.Print(vars, "Add$service_name$LoadMethods(channels[i], i, &methods);\n");
+  }
+
+  void DoPrintLoadEnd(Printer &printer) const
+  {
+    printer.Outdent();
+    printer.Print("}\n");
+    printer.Print(
+        "\nstd::vector<grpc::ScenarioMethod> scenario;\n"
+        "grpc::string error;\n"
+        "if (!FLAGS_scenario.empty() &&\n"
+        "    (!grpc::ReadLoadScenario(FLAGS_scenario, &scenario, &error) ||\n"
+        "     !grpc::ApplyLoadScenario(scenario, &methods, &error))) {\n"
+        "  std::cerr << error << std::endl;\n"
+        "  return 1;\n"
+        "}\n"
+        "\ngrpc::LoadOptions options;\n"
+        "options.concurrency = FLAGS_concurrency;\n"
+        "options.duration_seconds = FLAGS_duration;\n"
+        "options.max_rpcs = FLAGS_max_rpcs;\n"
+        "options.async = FLAGS_async;\n"
+        "options.outstanding_rpcs = FLAGS_outstanding_rpcs;\n"
+        "options.target_qps = FLAGS_target_qps;\n"
+        "options.poisson = FLAGS_poisson;\n"
+        "options.generic = FLAGS_generic_stub;\n"
+        "options.parse_sample_rate = FLAGS_parse_sample_rate;\n"
+        "options.hash_responses = FLAGS_hash_responses;\n"
+        "options.weighted = !FLAGS_scenario.empty();\n");
+    if (options.callback_api) {
+      printer.Print("options.callback = true;\n");
+    }
+    printer.Print(
+        "grpc::PrintLoadStats(grpc::RunLoad(methods, options), std::cout);\n"
+        "return 0;\n");
+    printer.Outdent();
+    printer.Print("}\n\n");
+  }
+
+  void DoPrintMethodCallDeclaration(Printer &printer, vars_t &vars) const
+  {
+    PrintSignature(printer, vars, method_call_signature, ";\n");
+  }
+
+  void DoPrintServiceLoadDeclaration(Printer &printer, vars_t &vars) const
+  {
+    PrintSignature(printer, vars, service_load_signature, ";\n");
+  }
+
+  void DoStartMain(Printer &printer) const
+  {
+    printer.Print("int main(int argc, char** argv) {\n");
+    printer.Indent();
+  }
+
+  void DoEndFunction(Printer &printer) const
+  {
+    printer.Outdent();
+    printer.Print("}\n");
+  }
+};
+
+
+std::unique_ptr<AbstractGenerator> NewCppGrpcClientGenerator() {
+  return std::unique_ptr<AbstractGenerator>(new CppGrpcClientGenerator());
+}
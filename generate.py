@@ -36,15 +36,88 @@ for client generation to occur for a particular language.
 from __future__ import print_function
 
 import argparse
+import fcntl
+import glob
+import hashlib
+import json
 import os
+import re
 import sys
 import itertools
 import subprocess
 import shutil
+import tempfile
+from multiprocessing.pool import ThreadPool
 
-def run_and_wait(cmd):
-  proc = subprocess.Popen(args=cmd)
-  proc.wait()
+# Name of the file in the output directory that records what the current
+# outputs were generated from. Used by --incremental.
+MANIFEST = ".generate_manifest.json"
+
+def run_and_wait(cmd, cwd=None):
+  """Runs cmd to completion, raising subprocess.CalledProcessError if it
+  fails, so that a failed step is never recorded in the manifest."""
+  subprocess.check_call(args=cmd, cwd=cwd)
+
+def find_binary(binary):
+  for directory in os.environ.get("PATH", "").split(os.pathsep):
+    path = os.path.join(directory, binary)
+    if os.path.isfile(path):
+      return path
+  return binary
+
+def hash_files(paths, salt=""):
+  """Hashes the names and contents of paths. Missing files hash as absent."""
+  digest = hashlib.sha1(salt.encode("utf-8"))
+  for path in sorted(set(paths)):
+    digest.update(path.encode("utf-8"))
+    if os.path.isfile(path):
+      with open(path, "rb") as f:
+        digest.update(f.read())
+    else:
+      digest.update(b"<missing>")
+  return digest.hexdigest()
+
+_IMPORT_RE = re.compile(r'^\s*import\s+(?:public\s+|weak\s+)?"([^"]+)"\s*;',
+                        re.MULTILINE)
+
+def proto_closure(proto, include_dirs):
+  """Returns (include_dir, name) for proto and every proto it imports,
+  transitively, that is found in include_dirs. name is the path imports use.
+  proto comes first. Imports that are not found, like the well known types,
+  are left to protoc's own include path."""
+  root = os.path.basename(proto)
+  found = {}
+  pending = [root]
+  while pending:
+    name = pending.pop()
+    if name in found:
+      continue
+    for include_dir in include_dirs:
+      path = os.path.join(include_dir, name)
+      if os.path.isfile(path):
+        found[name] = include_dir
+        with open(path, "r") as f:
+          pending.extend(_IMPORT_RE.findall(f.read()))
+        break
+  return [(found[root], root)] + sorted(
+      (found[name], name) for name in found if name != root)
+
+def load_manifest():
+  path = os.path.join(GENERATED_DIR, MANIFEST)
+  if not os.path.exists(path):
+    return {}
+  with open(path, "r") as f:
+    return json.load(f)
+
+def update_manifest(entries):
+  """Merges entries into the manifest. Several generate.py processes may
+  share an output directory, so the update happens under a lock."""
+  with open(os.path.join(GENERATED_DIR, MANIFEST + ".lock"), "w") as lock:
+    fcntl.flock(lock, fcntl.LOCK_EX)
+    manifest = load_manifest()
+    manifest.update(entries)
+    with open(os.path.join(GENERATED_DIR, MANIFEST), "w") as f:
+      json.dump(manifest, f, indent=2, sort_keys=True)
 
 def check_path(binary):
   with open(os.devnull, "w") as devnull:
@@ -57,81 +130,110 @@ def check_path(binary):
 class CXXLanguage:
   def name(self):
     return "cpp"
-  def create_makefile(self, uniquename):
-    makefile = open("BUILD", "w")
+  def extensions(self):
+    # split_services output adds a header and one file per service
+    return (".grpc.client.pb.cc", ".grpc.client.pb.h")
+  def inputs(self):
+    return [ROOT + "/template/BUILD.cpp.template",
+            "/usr/local/bin/grpc_cpp_plugin"]
+  def create_makefile(self, uniquename, workdir):
+    makefile = open(os.path.join(workdir, "BUILD"), "w")
     template = open(ROOT + "/template/BUILD.cpp.template", "r").read()
     makefile.write(template.format(uniquename=uniquename))
     makefile.close()
-  def do_prework(self, uniquename):
+  def enable_arenas(self, workdir, protos):
+    # protobuf releases before 3.14 only allocate the messages of files with
+    # cc_enable_arenas on arenas
+    for proto in protos:
+      path = os.path.join(workdir, proto)
+      contents = open(path).read()
+      if not re.search(r"\bcc_enable_arenas\b", contents):
+        with open(path, "a") as f:
+          f.write("\noption cc_enable_arenas = true;\n")
+  def do_prework(self, uniquename, workdir, protos):
     print("c++ pre work")
-    self.create_makefile(uniquename)
-    run_and_wait(["protoc", "-I", ".", "--cpp_out=.", uniquename + ".proto"])
-    run_and_wait(["protoc", "-I", ".", "--grpc_out=.", 
-        "--plugin=protoc-gen-grpc=/usr/local/bin/grpc_cpp_plugin", 
-        uniquename + ".proto"])
-  def generate_client(self, uniquename):
-    print("c++ main work")
+    self.create_makefile(uniquename, workdir)
+    if "arena" in generator_option_names:
+      self.enable_arenas(workdir, protos)
+    run_and_wait(["protoc", "-I", ".", "--cpp_out=."] + protos,
+        cwd=workdir)
     run_and_wait(["protoc", "-I", ".", "--grpc_out=.", 
-        "--plugin=protoc-gen-grpc=../../bazel-bin/cpp_generator", 
-        uniquename + ".proto"])
+        "--plugin=protoc-gen-grpc=/usr/local/bin/grpc_cpp_plugin"] + protos,
+        cwd=workdir)
 
 class GoLanguage:
   def name(self):
     return "go"
+  def extensions(self):
+    return (".grpc.client.pb.go",)
+  def inputs(self):
+    return [ROOT + "/template/BUILD.go.template",
+            ROOT + "/template/BUILD.go.pb.template",
+            find_binary("protoc-gen-go")]
   def check_path(self):
     check_path("go")
     check_path("protoc-gen-go") 
-  def create_makefile(self, uniquename):
-    makefile = open("BUILD", "w")
+  def create_makefile(self, uniquename, workdir):
+    makefile = open(os.path.join(workdir, "BUILD"), "w")
     template = open(ROOT + "/template/BUILD.go.template", "r").read()
     makefile.write(template.format(uniquename=uniquename))
     makefile.close()        
-  def generate_pb_files(self, uniquename):
-    run_and_wait(["protoc", "-I", ".", "--go_out=plugins=grpc:.", uniquename + ".proto"])
-    run_and_wait(["sed", "-i", "", "/SupportPackageIsVersion4/d", uniquename + ".pb.go"]) # TODO: reevaluate the life choices that led to this line
+  def generate_pb_files(self, uniquename, workdir, protos):
+    run_and_wait(["protoc", "-I", ".", "--go_out=plugins=grpc:."] + protos,
+        cwd=workdir)
+    # the prober refers to all messages through one package, so all of the
+    # files go into it
+    pb_files = [proto[:-6] + ".pb.go" for proto in protos]
+    run_and_wait(["sed", "-i", "", "/SupportPackageIsVersion4/d"] + pb_files,
+        cwd=workdir) # TODO: reevaluate the life choices that led to this line
     genpath = ROOT + "/generated_go_pb_files/" + uniquename
     if os.path.exists(genpath):
       shutil.rmtree(genpath)
     os.mkdir(genpath)
-    shutil.move(uniquename + ".pb.go", ROOT + "/generated_go_pb_files/" + uniquename + "/" + uniquename + ".pb.go")
-    makefile = open("BUILD.pb", "w")
+    for pb_file in pb_files:
+      shutil.move(os.path.join(workdir, pb_file),
+                  os.path.join(genpath, os.path.basename(pb_file)))
+    makefile = open(genpath + "/BUILD", "w")
     template = open(ROOT + "/template/BUILD.go.pb.template", "r").read()
     makefile.write(template.format(uniquename=uniquename))
     makefile.close()
-    shutil.move("BUILD.pb", ROOT + "/generated_go_pb_files/" + uniquename + "/BUILD")
-  def do_prework(self, uniquename):
+  def do_prework(self, uniquename, workdir, protos):
     print("go pre work")
     self.check_path()
-    self.create_makefile(uniquename)
-    self.generate_pb_files(uniquename)
-  def generate_client(self, uniquename):
-    print("go main work")
-    run_and_wait(["protoc", "-I", ".", "--grpc_out=.", 
-        "--plugin=protoc-gen-grpc=../../bazel-bin/go_generator", 
-        uniquename + ".proto"])
+    self.create_makefile(uniquename, workdir)
+    self.generate_pb_files(uniquename, workdir, protos)
 
 class PythonLanguage:
   def name(self):
     return "python"
-  def copy_helpers(self, uniquename):
-    shutil.copy(ROOT + "/util/python/create_prober_channel.py", 
-        ROOT + "/generated_probers/" + uniquename + "_" + self.name() + "/")
+  def extensions(self):
+    return (".grpc.client.pb.py",)
+  def inputs(self):
+    return ([ROOT + "/util/python/create_prober_channel.py",
+             ROOT + "/util/python/stream_stats.py",
+             "/usr/local/bin/grpc_python_plugin"] +
+            glob.glob(ROOT + "/util/python/credential/*"))
+  def copy_helpers(self, uniquename, workdir):
+    shutil.copy(ROOT + "/util/python/create_prober_channel.py", workdir)
+    shutil.copy(ROOT + "/util/python/stream_stats.py", workdir)
     shutil.copytree(ROOT + "/util/python/credential", 
-        ROOT + "/generated_probers/" + uniquename + "_" + self.name() + "/credential")
-  def do_prework(self, uniquename):
+        os.path.join(workdir, "credential"))
+  def make_packages(self, workdir, protos):
+    # imported protos in subdirectories are imported as packages
+    for proto in protos:
+      directory = os.path.dirname(proto)
+      while directory:
+        open(os.path.join(workdir, directory, "__init__.py"), "a").close()
+        directory = os.path.dirname(directory)
+  def do_prework(self, uniquename, workdir, protos):
     print("python pre work")
-    run_and_wait(["protoc", "-I", ".", "--python_out=.", uniquename + ".proto"])
-    run_and_wait(["protoc", "-I", ".", "--python_out=.", "--grpc_out=.", 
-        "--plugin=protoc-gen-grpc=/usr/local/bin/grpc_python_plugin", 
-        uniquename + ".proto"])
-    self.copy_helpers(uniquename)
-    pass
-  def generate_client(self, uniquename):
-    print("python main work")
+    run_and_wait(["protoc", "-I", ".", "--python_out=."] + protos,
+        cwd=workdir)
     run_and_wait(["protoc", "-I", ".", "--python_out=.", "--grpc_out=.", 
-        "--plugin=protoc-gen-grpc=../../bazel-bin/python_generator", 
-        uniquename + ".proto"])
-    pass
+        "--plugin=protoc-gen-grpc=/usr/local/bin/grpc_python_plugin"] + protos,
+        cwd=workdir)
+    self.make_packages(workdir, protos)
+    self.copy_helpers(uniquename, workdir)
 
 _LANGUAGES = {
     'c++' : CXXLanguage(),
@@ -149,21 +251,44 @@ argp.add_argument('-l', '--language',
 argp.add_argument('-p', '--proto',
                   required=True,
                   help='proto file from which to generate')
+argp.add_argument('-I', '--proto_path',
+                  action='append',
+                  default=[],
+                  help='additional directory to search for imports, may be '
+                       'given several times. The directory of the proto '
+                       'is always searched first')
 argp.add_argument('-d', '--directory',
                   default="generated_probers",
                   help='directory to place generated files')
 argp.add_argument('--no-rebuild', dest='rebuild',
                   action='store_false')
+argp.add_argument('-j', '--jobs',
+                  type=int,
+                  default=0,
+                  help='number of jobs to run in parallel, '
+                       'defaults to the number of cpus')
+argp.add_argument('--incremental',
+                  action='store_true',
+                  help='skip the work whose inputs did not change since the '
+                       'last run into the same directory')
+argp.add_argument('--generator_options',
+                  default="",
+                  help='comma separated options passed to the generator, '
+                       'e.g. split_services,methods_per_file=50')
 argp.set_defaults(rebuild=True)
 
 args = argp.parse_args()
+generator_option_names = set(option.split("=")[0]
+                             for option in args.generator_options.split(","))
 
 # ensure we run from the root dir of the repo
 ROOT = os.path.abspath(os.path.dirname(sys.argv[0]))
 os.chdir(ROOT)
-if not os.path.exists(args.directory):
-  os.mkdir(args.directory)
 GENERATED_DIR = os.path.join(ROOT, args.directory)
+try:
+  os.mkdir(GENERATED_DIR)
+except OSError:
+  pass # already exists, possibly created by a concurrent run
 
 # validate the proto arg
 if not args.proto.endswith(".proto"):
@@ -179,26 +304,101 @@ languages = set(_LANGUAGES[l]
                       for x in args.language))
 
 
-# make the generators
+manifest = load_manifest()
+# the entries this run produced, merged into the manifest at the end
+updates = {}
+
+# make the generator. One plugin generates the clients for all languages.
+# In incremental mode bazel is only invoked when the generator sources
+# changed or the plugin is missing.
+generator = ROOT + "/bazel-bin/multi_generator"
 if args.rebuild:
-  if 'all' in args.language:
-    run_and_wait(["bazel", "build", ":all"])
+  generator_key = hash_files(glob.glob(ROOT + "/*.cc") +
+                             glob.glob(ROOT + "/*.h") +
+                             [ROOT + "/BUILD", ROOT + "/WORKSPACE"])
+  if (args.incremental and manifest.get("generator") == generator_key and
+      os.path.exists(generator)):
+    print("generator is up to date")
   else:
-    for lang in languages:
-      run_and_wait(["bazel", "build", ":" + lang.name() + "_generator"])
+    run_and_wait(["bazel", "build", ":multi_generator"])
+    updates["generator"] = generator_key
+
+abspath = os.path.realpath(args.proto)
+uniquename = abspath.split("/")[-1][:-6]
+
+# the proto and everything it imports. One prober is generated for all of
+# them, so messages shared between files are only populated once.
+include_dirs = ([os.path.dirname(abspath)] +
+                [os.path.realpath(d) for d in args.proto_path])
+closure = proto_closure(abspath, include_dirs)
+protos = [name for include_dir, name in closure]
 
-# generate the directories for each language
+# everything a language's output depends on
+common_inputs = ([os.path.join(d, name) for d, name in closure] +
+                 [generator, find_binary("protoc")])
+keys = dict((lang, hash_files(common_inputs + lang.inputs(),
+                              args.generator_options))
+            for lang in languages)
+
+stale = []
 for lang in languages:
-  os.chdir(ROOT) # back to root
-  abspath = os.path.realpath(args.proto)
-  os.chdir(GENERATED_DIR)
-  uniquename = abspath.split("/")[-1][:-6]
   dirname = uniquename + "_" + lang.name()
-  if os.path.exists(dirname):
-    shutil.rmtree(dirname)
-  os.mkdir(dirname)
-  os.chdir(dirname)
-  shutil.copyfile(abspath, os.getcwd() + "/" + uniquename + ".proto")
-  lang.do_prework(uniquename)
-  lang.generate_client(uniquename)
+  if (args.incremental and manifest.get(dirname) == keys[lang] and
+      os.path.exists(os.path.join(GENERATED_DIR, dirname))):
+    print(dirname + " is up to date")
+  else:
+    stale.append(lang)
+
+# every language's prework is independent of the others and of the client
+# generation, so they all run in parallel, each in its own directory
+def prework(lang):
+  workdir = os.path.join(GENERATED_DIR, uniquename + "_" + lang.name())
+  if os.path.exists(workdir):
+    shutil.rmtree(workdir)
+  os.mkdir(workdir)
+  for include_dir, name in closure:
+    target = os.path.join(workdir, name)
+    if not os.path.isdir(os.path.dirname(target)):
+      os.makedirs(os.path.dirname(target))
+    shutil.copyfile(os.path.join(include_dir, name), target)
+  lang.do_prework(uniquename, workdir, protos)
+
+# generate every client with a single protoc invocation into a private
+# staging directory
+def generate_clients(staging):
+  print("main work")
+  run_and_wait(["protoc"] +
+      list(itertools.chain.from_iterable(["-I", d] for d in include_dirs)) +
+      ["--grpc_out=languages=" + ",".join(lang.name() for lang in stale) +
+           ("," + args.generator_options if args.generator_options else "") +
+           ":" + staging,
+       "--plugin=protoc-gen-grpc=" + generator] + protos)
+
+if stale:
+  staging = tempfile.mkdtemp(dir=GENERATED_DIR)
+  pool = ThreadPool(args.jobs or None)
+  results = [pool.apply_async(prework, (lang,)) for lang in stale]
+  results.append(pool.apply_async(generate_clients, (staging,)))
+  pool.close()
+  try:
+    for result in results:
+      result.get() # re-raises any failure
+  except Exception:
+    # none of the stale languages is recorded, so the next run redoes them
+    pool.join()
+    shutil.rmtree(staging)
+    update_manifest(updates)
+    raise
+  pool.join()
+
+  # move each client into its language's directory
+  for lang in stale:
+    dirname = uniquename + "_" + lang.name()
+    for output in os.listdir(staging):
+      if output.endswith(lang.extensions()):
+        shutil.move(os.path.join(staging, output),
+                    os.path.join(GENERATED_DIR, dirname))
+    updates[dirname] = keys[lang]
+  shutil.rmtree(staging)
 
+update_manifest(updates)
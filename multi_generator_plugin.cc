@@ -0,0 +1,173 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* A single plugin that generates probers for several languages in one protoc
+ * invocation. The proto files are analysed once, and every requested
+ * language's generator then runs on its own thread from that shared
+ * analysis. All of the files given to protoc go into one prober per
+ * language, named after the first file.
+ *
+ *   protoc --grpc_out=languages=cpp,go,python:<out_dir> \
+ *       --plugin=protoc-gen-grpc=bazel-bin/multi_generator <file>.proto \
+ *       [<imported file>.proto ...]
+ *
+ * Without a languages parameter, all languages are generated. Any other
+ * parameters are handed on to every generator.
+ */
+
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "cpp_generator.h"
+#include "go_generator.h"
+#include "python_generator.h"
+
+// Serializes Open() on the wrapped context. The streams it hands out each
+// write to their own file, so only opening a file needs the lock.
+class LockedGeneratorContext
+    : public grpc::protobuf::compiler::GeneratorContext {
+ public:
+  LockedGeneratorContext(grpc::protobuf::compiler::GeneratorContext *context)
+      : context_(context) {}
+
+  grpc::protobuf::io::ZeroCopyOutputStream *Open(
+      const grpc::string &filename) {
+    std::lock_guard<std::mutex> lock(mu_);
+    return context_->Open(filename);
+  }
+
+ private:
+  grpc::protobuf::compiler::GeneratorContext *context_;
+  std::mutex mu_;
+};
+
+class MultiLanguageGenerator : public grpc::protobuf::compiler::CodeGenerator {
+ public:
+  bool Generate(const grpc::protobuf::FileDescriptor *file,
+                const grpc::string &parameter,
+                grpc::protobuf::compiler::GeneratorContext *context,
+                grpc::string *error) const
+  {
+    return GenerateAll(
+        std::vector<const grpc::protobuf::FileDescriptor *>(1, file),
+        parameter, context, error);
+  }
+
+  // Generates one prober per language for all of files together.
+  bool GenerateAll(
+      const std::vector<const grpc::protobuf::FileDescriptor *> &files,
+      const grpc::string &parameter,
+      grpc::protobuf::compiler::GeneratorContext *context,
+      grpc::string *error) const
+  {
+    std::vector<std::pair<grpc::string, grpc::string> > options;
+    grpc::protobuf::compiler::ParseGeneratorParameter(parameter, &options);
+
+    // protoc splits the parameter on commas, so languages=cpp,go,python
+    // arrives as languages=cpp followed by the bare options go and python.
+    std::vector<grpc::string> languages;
+    grpc::string forwarded;
+    bool in_languages = false;
+    for (auto it = options.begin(); it != options.end(); ++it) {
+      if (it->first == "languages") {
+        languages.push_back(it->second);
+        in_languages = true;
+        continue;
+      }
+      if (in_languages && it->second.empty() && IsLanguage(it->first)) {
+        languages.push_back(it->first);
+        continue;
+      }
+      in_languages = false;
+      if (!forwarded.empty()) forwarded += ",";
+      forwarded += it->first;
+      if (!it->second.empty()) forwarded += "=" + it->second;
+    }
+    if (languages.empty()) languages = {"cpp", "go", "python"};
+
+    std::vector<std::unique_ptr<AbstractGenerator> > generators;
+    for (auto it = languages.begin(); it != languages.end(); ++it) {
+      if (*it == "cpp") {
+        generators.push_back(NewCppGrpcClientGenerator());
+      } else if (*it == "go") {
+        generators.push_back(NewGoGrpcClientGenerator());
+      } else if (*it == "python") {
+        generators.push_back(NewPythonGrpcClientGenerator());
+      } else {
+        *error = "Unknown language: " + *it;
+        return false;
+      }
+    }
+
+    // the analysis is shared read-only by all the generators
+    ProtoAnalysis analysis(files);
+    LockedGeneratorContext locked_context(context);
+    std::vector<grpc::string> errors(generators.size());
+    std::vector<char> ok(generators.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < generators.size(); ++i) {
+      threads.emplace_back([&, i]() {
+        ok[i] = generators[i]->Generate(analysis, forwarded, &locked_context,
+                                        &errors[i]);
+      });
+    }
+    for (auto it = threads.begin(); it != threads.end(); ++it) {
+      it->join();
+    }
+
+    for (size_t i = 0; i < generators.size(); ++i) {
+      if (!ok[i]) {
+        *error = errors[i];
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  static bool IsLanguage(const grpc::string &name)
+  {
+    return name == "cpp" || name == "go" || name == "python";
+  }
+};
+
+
+int main(int argc, char *argv[]) {
+  srand(time(NULL));
+  MultiLanguageGenerator generator;
+  return grpc::protobuf::compiler::PluginMain(argc, argv, &generator);
+}
@@ -0,0 +1,202 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "proto_analysis.h"
+
+#include <algorithm>
+
+// Static helper. The message type a field refers to, or nullptr for scalars.
+static const grpc::protobuf::Descriptor *FieldMessage(
+    const grpc::protobuf::FieldDescriptor *field)
+{
+  if (field->type() == grpc::protobuf::FieldDescriptor::Type::TYPE_MESSAGE ||
+      field->type() == grpc::protobuf::FieldDescriptor::Type::TYPE_GROUP) {
+    return field->message_type();
+  }
+  return nullptr;
+}
+
+struct ProtoAnalysis::Traversal {
+  struct Node {
+    int index;
+    int lowlink;
+    bool on_stack;
+    size_t stack_pos;  // position in stack while on_stack
+  };
+  std::unordered_map<const grpc::protobuf::Descriptor *, Node> nodes;
+  std::vector<const grpc::protobuf::Descriptor *> stack;
+  int next_index = 0;
+  int next_component = 0;
+};
+
+ProtoAnalysis::ProtoAnalysis(const grpc::protobuf::FileDescriptor *file)
+    : ProtoAnalysis(
+          std::vector<const grpc::protobuf::FileDescriptor *>(1, file)) {}
+
+ProtoAnalysis::ProtoAnalysis(
+    const std::vector<const grpc::protobuf::FileDescriptor *> &files)
+    : files_(files)
+{
+  Traversal state;
+  for (auto file = files_.begin(); file != files_.end(); ++file) {
+    AddDependencies(*file);
+    for (int i = 0; i < (*file)->service_count(); ++i) {
+      auto service = (*file)->service(i);
+      services_.push_back(service);
+      for (int j = 0; j < service->method_count(); ++j) {
+        auto method = service->method(j);
+        if (state.nodes.find(method->input_type()) == state.nodes.end()) {
+          Visit(method->input_type(), &state);
+        }
+      }
+    }
+  }
+
+  // messages_ lists every component after the components it refers to, and
+  // the members of a component next to each other, so a single forward pass
+  // sees the final heights of all the children of a component
+  for (auto begin = messages_.begin(); begin != messages_.end();) {
+    int component = info_[*begin].component;
+    auto end = begin;
+    int height = 0;
+    for (; end != messages_.end() && info_[*end].component == component;
+         ++end) {
+      for (int i = 0; i < (*end)->field_count(); ++i) {
+        auto child = FieldMessage((*end)->field(i));
+        if (child == nullptr) continue;
+        const MessageInfo &child_info = info_[child];
+        if (child_info.component != component) {
+          height = std::max(height, child_info.height + 1);
+        }
+      }
+    }
+    for (; begin != end; ++begin) {
+      info_[*begin].height = height;
+    }
+  }
+}
+
+void ProtoAnalysis::Visit(const grpc::protobuf::Descriptor *message,
+                          Traversal *state)
+{
+  Traversal::Node &node = state->nodes[message];
+  node.index = node.lowlink = state->next_index++;
+  node.on_stack = true;
+  node.stack_pos = state->stack.size();
+  state->stack.push_back(message);
+
+  // node stays valid across the visits below: rehashing an unordered_map
+  // moves no elements, so references to them survive
+  for (int i = 0; i < message->field_count(); ++i) {
+    const grpc::protobuf::Descriptor *child = FieldMessage(message->field(i));
+    if (child == nullptr) continue;
+    auto found = state->nodes.find(child);
+    if (found == state->nodes.end()) {
+      Visit(child, state);
+      node.lowlink = std::min(node.lowlink, state->nodes[child].lowlink);
+    } else if (found->second.on_stack) {
+      node.lowlink = std::min(node.lowlink, found->second.index);
+    }
+  }
+
+  if (node.lowlink != node.index) return;
+
+  // message is the root of a component: pop it off the stack, and list its
+  // members in the order they were discovered. The component starts where
+  // message was pushed; searching the stack for it would be quadratic on
+  // long chains of messages.
+  auto begin = state->stack.begin() + node.stack_pos;
+  int component = state->next_component++;
+  bool recursive = state->stack.end() - begin > 1;
+  for (auto it = begin; it != state->stack.end(); ++it) {
+    state->nodes[*it].on_stack = false;
+    if (!recursive) {
+      // a single message is only recursive if it refers to itself
+      for (int i = 0; i < (*it)->field_count(); ++i) {
+        if (FieldMessage((*it)->field(i)) == *it) recursive = true;
+      }
+    }
+  }
+  for (auto it = begin; it != state->stack.end(); ++it) {
+    MessageInfo info;
+    info.component = component;
+    info.recursive = recursive;
+    info.height = 0;
+    info_[*it] = info;
+    messages_.push_back(*it);
+  }
+  state->stack.erase(begin, state->stack.end());
+}
+
+void ProtoAnalysis::AddDependencies(
+    const grpc::protobuf::FileDescriptor *file)
+{
+  if (std::find(dependencies_.begin(), dependencies_.end(), file) !=
+      dependencies_.end()) {
+    return;
+  }
+  for (int i = 0; i < file->dependency_count(); ++i) {
+    AddDependencies(file->dependency(i));
+  }
+  dependencies_.push_back(file);
+}
+
+const ProtoAnalysis::MessageInfo *ProtoAnalysis::Find(
+    const grpc::protobuf::Descriptor *message) const
+{
+  auto found = info_.find(message);
+  return found == info_.end() ? nullptr : &found->second;
+}
+
+bool ProtoAnalysis::IsRecursive(const grpc::protobuf::Descriptor *message) const
+{
+  const MessageInfo *info = Find(message);
+  return info != nullptr && info->recursive;
+}
+
+bool ProtoAnalysis::IsRecursiveField(
+    const grpc::protobuf::FieldDescriptor *field) const
+{
+  const grpc::protobuf::Descriptor *child = FieldMessage(field);
+  if (child == nullptr) return false;
+  const MessageInfo *info = Find(field->containing_type());
+  const MessageInfo *child_info = Find(child);
+  return info != nullptr && child_info != nullptr &&
+         info->recursive && info->component == child_info->component;
+}
+
+int ProtoAnalysis::Height(const grpc::protobuf::Descriptor *message) const
+{
+  const MessageInfo *info = Find(message);
+  return info == nullptr ? 0 : info->height;
+}
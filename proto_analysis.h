@@ -0,0 +1,132 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Language independent analysis of a set of proto files. It is computed
+ * once per protoc run and can be shared by any number of generators,
+ * including generators running concurrently, since it is never modified
+ * after construction.
+ *
+ * The analysis walks the graph formed by message typed fields, starting at
+ * the request types of the files' methods in declaration order. Messages
+ * shared by several files are only listed once. Everything
+ * it returns depends only on the order of declarations in the proto files,
+ * never on where descriptors happen to live in memory, so generating twice
+ * from the same input gives byte-identical output.
+ */
+
+#ifndef SRC_GENERATOR_PROTO_ANALYSIS_H
+#define SRC_GENERATOR_PROTO_ANALYSIS_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "config.h"
+
+class ProtoAnalysis {
+ public:
+  explicit ProtoAnalysis(const grpc::protobuf::FileDescriptor *file);
+
+  // Analyses all of files together. files must not be empty.
+  explicit ProtoAnalysis(
+      const std::vector<const grpc::protobuf::FileDescriptor *> &files);
+
+  // The first of the analysed files, which names the generated prober.
+  const grpc::protobuf::FileDescriptor *file() const { return files_[0]; }
+
+  // The analysed files, in the order they were given.
+  const std::vector<const grpc::protobuf::FileDescriptor *> &files() const {
+    return files_;
+  }
+
+  // The analysed files and every file they import, transitively. Every
+  // file comes after the files it imports.
+  const std::vector<const grpc::protobuf::FileDescriptor *> &dependencies()
+      const {
+    return dependencies_;
+  }
+
+  // All message types reachable from the request types of the files'
+  // methods. These are the messages that need a populating function.
+  // Every message comes after the messages its fields refer to, except
+  // for the fields that close a cycle; see IsRecursiveField.
+  const std::vector<const grpc::protobuf::Descriptor *> &messages() const {
+    return messages_;
+  }
+
+  // The services of the files, in declaration order.
+  const std::vector<const grpc::protobuf::ServiceDescriptor *> &services()
+      const {
+    return services_;
+  }
+
+  // True if message can (indirectly) contain itself.
+  bool IsRecursive(const grpc::protobuf::Descriptor *message) const;
+
+  // True if field refers to a message in the same cycle as the message
+  // that contains it. Populating such a field would never terminate.
+  bool IsRecursiveField(const grpc::protobuf::FieldDescriptor *field) const;
+
+  // Length of the longest chain of message fields below message, with
+  // every cycle counted as a single step. Messages with only scalar fields
+  // have height 0.
+  int Height(const grpc::protobuf::Descriptor *message) const;
+
+ private:
+  struct MessageInfo {
+    // strongly connected component, numbered in the order of messages_
+    int component;
+    bool recursive;
+    int height;
+  };
+
+  struct Traversal;
+
+  // Tarjan's algorithm. Components are completed after every component
+  // they refer to, which is what gives messages_ its order.
+  void Visit(const grpc::protobuf::Descriptor *message, Traversal *state);
+
+  // Appends file and its imports to dependencies_, imports first.
+  void AddDependencies(const grpc::protobuf::FileDescriptor *file);
+
+  // Returns the analysis of a reachable message, or nullptr.
+  const MessageInfo *Find(const grpc::protobuf::Descriptor *message) const;
+
+  std::vector<const grpc::protobuf::FileDescriptor *> files_;
+  std::vector<const grpc::protobuf::FileDescriptor *> dependencies_;
+  std::vector<const grpc::protobuf::Descriptor *> messages_;
+  std::vector<const grpc::protobuf::ServiceDescriptor *> services_;
+  // memoized per-message results, keyed by descriptor but never iterated
+  std::unordered_map<const grpc::protobuf::Descriptor *, MessageInfo> info_;
+};
+
+#endif  // SRC_GENERATOR_PROTO_ANALYSIS_H
@@ -0,0 +1,181 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "proto_analysis.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/text_format.h>
+
+namespace {
+
+#define EXPECT(condition)                                                 \
+  do {                                                                    \
+    if (!(condition)) {                                                   \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": " #condition         \
+                << std::endl;                                             \
+      std::exit(1);                                                       \
+    }                                                                     \
+  } while (0)
+
+// A self-recursive message, a mutually recursive pair and an acyclic
+// chain, each reached from the request of a method.
+const char kProto[] =
+    "name: 'analysis.proto' package: 't' syntax: 'proto3' "
+    "message_type { name: 'Self' "
+    "  field { name: 'child' number: 1 label: LABEL_OPTIONAL "
+    "          type: TYPE_MESSAGE type_name: '.t.Self' } "
+    "  field { name: 'x' number: 2 label: LABEL_OPTIONAL type: TYPE_INT32 } "
+    "} "
+    "message_type { name: 'Ping' "
+    "  field { name: 'pong' number: 1 label: LABEL_OPTIONAL "
+    "          type: TYPE_MESSAGE type_name: '.t.Pong' } "
+    "} "
+    "message_type { name: 'Pong' "
+    "  field { name: 'ping' number: 1 label: LABEL_REPEATED "
+    "          type: TYPE_MESSAGE type_name: '.t.Ping' } "
+    "  field { name: 'leaf' number: 2 label: LABEL_OPTIONAL "
+    "          type: TYPE_MESSAGE type_name: '.t.Leaf' } "
+    "} "
+    "message_type { name: 'Top' "
+    "  field { name: 'middle' number: 1 label: LABEL_OPTIONAL "
+    "          type: TYPE_MESSAGE type_name: '.t.Middle' } "
+    "} "
+    "message_type { name: 'Middle' "
+    "  field { name: 'leaf' number: 1 label: LABEL_OPTIONAL "
+    "          type: TYPE_MESSAGE type_name: '.t.Leaf' } "
+    "} "
+    "message_type { name: 'Leaf' "
+    "  field { name: 'v' number: 1 label: LABEL_OPTIONAL type: TYPE_INT32 } "
+    "} "
+    "service { name: 'Svc' "
+    "  method { name: 'Chain' input_type: '.t.Top' output_type: '.t.Leaf' } "
+    "  method { name: 'Pair' input_type: '.t.Ping' output_type: '.t.Leaf' } "
+    "  method { name: 'Loop' input_type: '.t.Self' output_type: '.t.Leaf' } "
+    "}";
+
+// Everything the generators read from an analysis, as text.
+grpc::string Dump(const ProtoAnalysis &analysis) {
+  std::ostringstream out;
+  for (auto it = analysis.messages().begin(); it != analysis.messages().end();
+       ++it) {
+    out << (*it)->full_name() << " height " << analysis.Height(*it)
+        << (analysis.IsRecursive(*it) ? " recursive" : "") << "\n";
+    for (int i = 0; i < (*it)->field_count(); ++i) {
+      if (analysis.IsRecursiveField((*it)->field(i))) {
+        out << "  " << (*it)->field(i)->name() << " recursive\n";
+      }
+    }
+  }
+  return out.str();
+}
+
+const google::protobuf::FileDescriptor *Build(
+    google::protobuf::DescriptorPool *pool) {
+  google::protobuf::FileDescriptorProto proto;
+  EXPECT(google::protobuf::TextFormat::ParseFromString(kProto, &proto));
+  const google::protobuf::FileDescriptor *file = pool->BuildFile(proto);
+  EXPECT(file != nullptr);
+  return file;
+}
+
+void TestCycles() {
+  google::protobuf::DescriptorPool pool;
+  const google::protobuf::FileDescriptor *file = Build(&pool);
+  ProtoAnalysis analysis(file);
+  auto message = [&](const char *name) {
+    return pool.FindMessageTypeByName(grpc::string("t.") + name);
+  };
+  auto field = [&](const char *name, const char *field_name) {
+    return message(name)->FindFieldByName(field_name);
+  };
+
+  EXPECT(analysis.IsRecursive(message("Self")));
+  EXPECT(analysis.IsRecursive(message("Ping")));
+  EXPECT(analysis.IsRecursive(message("Pong")));
+  EXPECT(!analysis.IsRecursive(message("Top")));
+  EXPECT(!analysis.IsRecursive(message("Leaf")));
+
+  EXPECT(analysis.IsRecursiveField(field("Self", "child")));
+  EXPECT(!analysis.IsRecursiveField(field("Self", "x")));
+  EXPECT(analysis.IsRecursiveField(field("Ping", "pong")));
+  EXPECT(analysis.IsRecursiveField(field("Pong", "ping")));
+  EXPECT(!analysis.IsRecursiveField(field("Pong", "leaf")));
+  EXPECT(!analysis.IsRecursiveField(field("Top", "middle")));
+  EXPECT(!analysis.IsRecursiveField(field("Middle", "leaf")));
+
+  // every component after the ones it refers to, its members in the order
+  // they were found, the components in the order of the methods
+  EXPECT(Dump(analysis) ==
+         "t.Leaf height 0\n"
+         "t.Middle height 1\n"
+         "t.Top height 2\n"
+         "t.Ping height 1 recursive\n"
+         "  pong recursive\n"
+         "t.Pong height 1 recursive\n"
+         "  ping recursive\n"
+         "t.Self height 0 recursive\n"
+         "  child recursive\n");
+}
+
+// The same file in pools built in different orders, so its descriptors
+// sit at other addresses, analyses the same.
+void TestDeterministic() {
+  google::protobuf::DescriptorPool first;
+  grpc::string expected = Dump(ProtoAnalysis(Build(&first)));
+  for (int run = 0; run < 10; ++run) {
+    google::protobuf::DescriptorPool pool;
+    // moves the heap along, and the next file takes other names first
+    std::vector<grpc::string> padding(run * 100, grpc::string(64, 'x'));
+    google::protobuf::FileDescriptorProto other;
+    other.set_name("other" + std::to_string(run) + ".proto");
+    for (int i = 0; i < run; ++i) {
+      other.add_message_type()->set_name("M" + std::to_string(i));
+    }
+    EXPECT(pool.BuildFile(other) != nullptr);
+    EXPECT(Dump(ProtoAnalysis(Build(&pool))) == expected);
+  }
+}
+
+}  // namespace
+
+int main() {
+  TestCycles();
+  TestDeterministic();
+  std::cout << "PASSED" << std::endl;
+  return 0;
+}
@@ -0,0 +1,289 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <memory>
+#include <sstream>
+#include <cstdlib>
+#include <map>
+
+#include "python_generator.h"
+
+static std::map<grpc::protobuf::FieldDescriptor::Type, grpc::string> sentinel_data {
+    {grpc::protobuf::FieldDescriptor::TYPE_DOUBLE, "1.234"},
+    {grpc::protobuf::FieldDescriptor::TYPE_FLOAT, "1.234"},
+    {grpc::protobuf::FieldDescriptor::TYPE_INT64, "1234"},
+    {grpc::protobuf::FieldDescriptor::TYPE_UINT64, "1234"},
+    {grpc::protobuf::FieldDescriptor::TYPE_INT32, "123"},
+    {grpc::protobuf::FieldDescriptor::TYPE_FIXED64, "1234"},
+    {grpc::protobuf::FieldDescriptor::TYPE_FIXED32, "123"},
+    {grpc::protobuf::FieldDescriptor::TYPE_BOOL, "True"},
+    {grpc::protobuf::FieldDescriptor::TYPE_STRING, "\"Hello world\""},
+    {grpc::protobuf::FieldDescriptor::TYPE_BYTES, "\"Hello world\""},
+    {grpc::protobuf::FieldDescriptor::TYPE_UINT32, "123"},
+    {grpc::protobuf::FieldDescriptor::TYPE_SFIXED32, "123"},
+    {grpc::protobuf::FieldDescriptor::TYPE_SFIXED64, "1234"},
+    {grpc::protobuf::FieldDescriptor::TYPE_SINT32, "123"},
+    {grpc::protobuf::FieldDescriptor::TYPE_SINT64, "1234"},
+};
+
+class PythonGrpcClientGenerator : public AbstractGenerator {
+ private:
+  // "foo/bar-baz.proto" -> "foo.bar_baz", the module prefix of the
+  // generated code
+  static grpc::string ModuleName(const grpc::string &file_name)
+  {
+    grpc::string module = StripProto(file_name);
+    for (size_t i = 0; i < module.size(); ++i) {
+      if (module[i] == '/') module[i] = '.';
+      if (module[i] == '-') module[i] = '_';
+    }
+    return module;
+  }
+
+  // binds module to the module of the file named by vars[file_key]
+  static void BindModule(vars_t &vars, const char *file_key)
+  {
+    // copied first, interning "module" may move the other values
+    grpc::string module = ModuleName(vars[file_key]);
+    vars["module"] = module;
+  }
+
+  grpc::string GetLanguageSpecificFileExtension() const 
+  { 
+    return ".grpc.client.pb.py"; 
+  }
+
+  grpc::string GetCommentPrefix() const 
+  {
+    return "# "; 
+  }
+
+  void DoPrintIncludes(Printer &printer, vars_t &vars) const
+  {
+    printer.Print("from __future__ import print_function\n\n");
+
+    printer.Print("import grpc\n\n");
+
+    // messages may come from any imported file, stubs only from the files
+    // the prober was generated for
+    const std::vector<const grpc::protobuf::FileDescriptor *> &dependencies =
+        analysis->dependencies();
+    for (auto it = dependencies.begin(); it != dependencies.end(); ++it) {
+      vars["module"] = ModuleName((*it)->name());
+      printer.Print(vars, "import $module$_pb2\n");
+    }
+    for (auto it = analysis->files().begin(); it != analysis->files().end();
+         ++it) {
+      if ((*it)->service_count() == 0) continue;
+      vars["module"] = ModuleName((*it)->name());
+      printer.Print(vars, "import $module$_pb2_grpc\n");
+    }
+    printer.NewLine();
+
+    printer.Print("from create_prober_channel import create_prober_channel\n"
+                  "from create_prober_channel import prober_args\n"
+                  "from stream_stats import PingPongStats\n"
+                  "from stream_stats import StreamStats\n"
+                  "from stream_stats import WriteStats\n\n");
+  }
+
+  void DoPrintFlags(Printer &printer, vars_t &vars) const
+  {
+    // TODO
+  }
+
+  void DoCreateChannel(Printer &printer) const
+  {
+    printer.Print("# argument parsing is handled in the util file too.\n");
+    printer.Print("channel = create_prober_channel()\n");
+  }
+
+  void DoParseFlags(Printer &printer) const
+  {
+    // printer.Print("ParseCommandLineFlags(&argc, &argv, true);\n");
+  }
+
+  void DoStartPrint(Printer &printer) const
+  {
+    printer.Print("print(\"");
+  }
+
+  void DoEndPrint(Printer &printer) const
+  {
+    printer.Print("\")\n");
+  }
+
+  void DoPrintMessagePopulatingFunctionStart(
+      Printer &printer, vars_t &vars) const
+  {
+    printer.Print(
+        vars, "def Populate$message_id$(message):\n");
+    printer.Indent();
+  }
+
+  void DoPrintMessagePopulatingFunctionEnd(Printer &printer) const
+  {
+    DoEndFunction(printer);
+  }
+
+
+  void DoPrintMethodProbeStart(Printer &printer, vars_t &vars) const
+  {
+    printer.Print(vars, "def Probe$service_name$$method_name$(stub):\n");
+    printer.Indent();
+  }
+
+  void DoPrintServiceProbeStart(Printer &printer, vars_t &vars) const
+  {
+    printer.Print(vars, "def Probe$service_name$(channel):\n");
+    printer.Indent();
+  }
+
+  void DoCreateStub(Printer &printer, vars_t &vars) const
+  {
+    BindModule(vars, "proto_filename_without_ext");
+    printer.Print(vars, "stub = $module$_pb2_grpc.$service_name$Stub(channel)\n");
+  }
+
+  void DoPopulateField(Printer &printer, vars_t &vars, 
+      grpc::protobuf::FieldDescriptor::Type type, bool repeated) const
+  {
+    vars["data"] = sentinel_data[type];
+    if (repeated) {
+      printer.Print(vars, "message.$field_name$.append($data$)\n");
+      printer.Print(vars, "message.$field_name$.append($data$)\n");
+    } else {
+      printer.Print(vars, "message.$field_name$ = $data$\n");
+    }
+  }
+
+  void DoEmptyMessage(Printer &printer, vars_t &vars) const 
+  {
+    printer.Print("pass\n");
+  }
+
+  void DoPopulateEnum(Printer &printer, vars_t &vars, bool repeated) const
+  {
+    BindModule(vars, "enum_file_without_ext");
+    if (repeated) {
+      printer.Print(vars, "message.$field_name$.append($module$_pb2.$enum_short_name$);\n");
+      printer.Print(vars, "message.$field_name$.append($module$_pb2.$enum_short_name$);\n");
+    } else {
+      printer.Print(vars, "message.$field_name$ = $module$_pb2.$enum_short_name$;\n");
+    }
+  }
+
+  void DoPopulateMessage(Printer &printer, vars_t &vars, bool repeated) const
+  {
+    if (repeated) {
+      printer.Print(vars, "Populate$message_id$(message.$field_name$.add());\n");
+      printer.Print(vars, "Populate$message_id$(message.$field_name$.add());\n");
+    } else {
+      printer.Print(vars, "Populate$message_id$(message.$field_name$);\n");
+    }
+  }
+
+  void DoUnaryUnary(Printer &printer, vars_t &vars) const
+  {
+    BindModule(vars, "request_file_without_ext");
+    printer.Print(vars, "request = $module$_pb2.$request_name$()\n");
+    printer.Print(vars, "Populate$request_id$(request)\n\n");
+    printer.Print(vars, "response = stub.$method_name$(request);\n\n");
+  }
+
+  void DoUnaryStream(Printer &printer, vars_t &vars) const
+  {
+    BindModule(vars, "request_file_without_ext");
+    printer.Print(vars, "request = $module$_pb2.$request_name$()\n");
+    printer.Print(vars, "Populate$request_id$(request)\n\n");
+    printer.Print(vars,
+        "stats = StreamStats()\n"
+        "for response in stub.$method_name$(request):\n"
+        "  stats.record(response.ByteSize())\n"
+        "stats.finish()\n"
+        "stats.report(\"$service_name$/$method_name$\")\n");
+  }
+
+  void DoStreamUnary(Printer &printer, vars_t &vars) const
+  {
+    BindModule(vars, "request_file_without_ext");
+    printer.Print(vars, "request = $module$_pb2.$request_name$()\n");
+    printer.Print(vars, "Populate$request_id$(request)\n\n");
+    printer.Print(vars,
+        "args = prober_args()\n"
+        "stats = WriteStats(args.stream_messages, args.stream_bytes)\n"
+        "response = stub.$method_name$(stats.send(request))\n"
+        "stats.finish()\n"
+        "stats.report(\"$service_name$/$method_name$\")\n");
+  }
+
+  void DoStreamStream(Printer &printer, vars_t &vars) const
+  {
+    BindModule(vars, "request_file_without_ext");
+    printer.Print(vars, "request = $module$_pb2.$request_name$()\n");
+    printer.Print(vars, "Populate$request_id$(request)\n\n");
+    printer.Print(vars,
+        "args = prober_args()\n"
+        "stats = PingPongStats(args.stream_messages)\n"
+        "stats.play(stub.$method_name$, request,\n"
+        "           args.stream_deadline_ms / 1000.0 or None)\n"
+        "stats.finish()\n"
+        "stats.report(\"$service_name$/$method_name$\")\n"
+        "stats.check(\"$service_name$/$method_name$\")\n");
+  }
+
+  void DoStartMain(Printer &printer) const
+  {
+    printer.Print("def main():\n");
+    printer.Indent();
+  }
+
+  void DoEndFunction(Printer &printer) const
+  {
+    printer.Outdent();
+    printer.NewLine();
+  }
+
+  void DoTrailer(Printer &printer) const
+  {
+    printer.Print("if __name__ == '__main__':\n");
+    printer.Indent();
+    printer.Print("main()\n");
+    printer.Outdent();
+  }
+};
+
+
+std::unique_ptr<AbstractGenerator> NewPythonGrpcClientGenerator() {
+  return std::unique_ptr<AbstractGenerator>(new PythonGrpcClientGenerator());
+}
@@ -1,6 +1,6 @@
 /*
  *
- * Copyright 2015, Google Inc.
+ * Copyright 2017, Google Inc.
  * All rights reserved.
  *
  * Redistribution and use in source and binary forms, with or without
@@ -31,180 +31,13 @@
  *
  */
 
-#include <memory>
-#include <sstream>
 #include <cstdlib>
-#include <map>
-
-#include "abstract_generator.h"
-
-static std::map<grpc::protobuf::FieldDescriptor::Type, grpc::string> sentinel_data {
-    {grpc::protobuf::FieldDescriptor::TYPE_DOUBLE, "1.234"},
-    {grpc::protobuf::FieldDescriptor::TYPE_FLOAT, "1.234"},
-    {grpc::protobuf::FieldDescriptor::TYPE_INT64, "1234"},
-    {grpc::protobuf::FieldDescriptor::TYPE_UINT64, "1234"},
-    {grpc::protobuf::FieldDescriptor::TYPE_INT32, "123"},
-    {grpc::protobuf::FieldDescriptor::TYPE_FIXED64, "1234"},
-    {grpc::protobuf::FieldDescriptor::TYPE_FIXED32, "123"},
-    {grpc::protobuf::FieldDescriptor::TYPE_BOOL, "True"},
-    {grpc::protobuf::FieldDescriptor::TYPE_STRING, "\"Hello world\""},
-    {grpc::protobuf::FieldDescriptor::TYPE_BYTES, "\"Hello world\""},
-    {grpc::protobuf::FieldDescriptor::TYPE_UINT32, "123"},
-    {grpc::protobuf::FieldDescriptor::TYPE_SFIXED32, "123"},
-    {grpc::protobuf::FieldDescriptor::TYPE_SFIXED64, "1234"},
-    {grpc::protobuf::FieldDescriptor::TYPE_SINT32, "123"},
-    {grpc::protobuf::FieldDescriptor::TYPE_SINT64, "1234"},
-};
-
-class PythonGrpcClientGenerator : public AbstractGenerator {
- private:
-  grpc::string GetLanguageSpecificFileExtension() const 
-  { 
-    return ".grpc.client.pb.py"; 
-  }
-
-  grpc::string GetCommentPrefix() const 
-  {
-    return "# "; 
-  }
-
-  void DoPrintIncludes(Printer &printer, vars_t &vars) const
-  {
-    printer.Print("from __future__ import print_function\n\n");
-
-    printer.Print("import grpc\n\n");
-
-    printer.Print(vars,"import $proto_filename_without_ext$_pb2\n"
-                       "import $proto_filename_without_ext$_pb2_grpc\n\n");
-
-    printer.Print("from create_prober_channel import create_prober_channel\n\n");
-  }
-
-  void DoPrintFlags(Printer &printer, vars_t &vars) const
-  {
-    // TODO
-  }
-
-  void DoCreateChannel(Printer &printer) const
-  {
-    printer.Print("# argument parsing is handled in the util file too.\n");
-    printer.Print("channel = create_prober_channel()\n");
-  }
-
-  void DoParseFlags(Printer &printer) const
-  {
-    // printer.Print("ParseCommandLineFlags(&argc, &argv, true);\n");
-  }
-
-  void DoStartPrint(Printer &printer) const
-  {
-    printer.Print("print(\"");
-  }
-
-  void DoEndPrint(Printer &printer) const
-  {
-    printer.Print("\")\n");
-  }
-
-  void DoPrintMessagePopulatingFunctionStart(
-      Printer &printer, vars_t &vars) const
-  {
-    printer.Print(
-        vars, "def Populate$message_name$(message):\n");
-    printer.Indent();
-  }
-
-  void DoPrintMessagePopulatingFunctionEnd(Printer &printer) const
-  {
-    DoEndFunction(printer);
-  }
-
-
-  void DoPrintMethodProbeStart(Printer &printer, vars_t &vars) const
-  {
-    printer.Print(vars, "def Probe$service_name$$method_name$(stub):\n");
-    printer.Indent();
-  }
-
-  void DoPrintServiceProbeStart(Printer &printer, vars_t &vars) const
-  {
-    printer.Print(vars, "def Probe$service_name$(channel):\n");
-    printer.Indent();
-  }
-
-  void DoCreateStub(Printer &printer, vars_t &vars) const
-  {
-    printer.Print(vars, "stub = $proto_filename_without_ext$_pb2_grpc.$service_name$Stub(channel)\n");
-  }
-
-  void DoPopulateField(Printer &printer, vars_t &vars, 
-      grpc::protobuf::FieldDescriptor::Type type, bool repeated) const
-  {
-    vars["data"] = sentinel_data[type];
-    if (repeated) {
-      printer.Print(vars, "message.$field_name$.append($data$)\n");
-      printer.Print(vars, "message.$field_name$.append($data$)\n");
-    } else {
-      printer.Print(vars, "message.$field_name$ = $data$\n");
-    }
-  }
-
-  void DoEmptyMessage(Printer &printer, vars_t &vars) const 
-  {
-    printer.Print("pass\n");
-  }
-
-  void DoPopulateEnum(Printer &printer, vars_t &vars, bool repeated) const
-  {
-    if (repeated) {
-      printer.Print(vars, "message.$field_name$.append($proto_filename_without_ext$_pb2.$enum_short_name$);\n");
-      printer.Print(vars, "message.$field_name$.append($proto_filename_without_ext$_pb2.$enum_short_name$);\n");
-    } else {
-      printer.Print(vars, "message.$field_name$ = $proto_filename_without_ext$_pb2.$enum_short_name$;\n");
-    }
-  }
-
-  void DoPopulateMessage(Printer &printer, vars_t &vars, bool repeated) const
-  {
-    if (repeated) {
-      printer.Print(vars, "Populate$message_name$(message.$field_name$.add());\n");
-      printer.Print(vars, "Populate$message_name$(message.$field_name$.add());\n");
-    } else {
-      printer.Print(vars, "Populate$message_name$(message.$field_name$);\n");
-    }
-  }
-
-  void DoUnaryUnary(Printer &printer, vars_t &vars) const
-  {
-    printer.Print(vars, "request = $proto_filename_without_ext$_pb2.$request_name$()\n");
-    printer.Print(vars, "Populate$request_name$(request)\n\n");
-    printer.Print(vars, "response = stub.$method_name$(request);\n\n");
-  }
-
-  void DoStartMain(Printer &printer) const
-  {
-    printer.Print("def main():\n");
-    printer.Indent();
-  }
-
-  void DoEndFunction(Printer &printer) const
-  {
-    printer.Outdent();
-    printer.NewLine();
-  }
-
-  void DoTrailer(Printer &printer) const
-  {
-    printer.Print("if __name__ == '__main__':\n");
-    printer.Indent();
-    printer.Print("main()\n");
-    printer.Outdent();
-  }
-};
+#include <ctime>
 
+#include "python_generator.h"
 
 int main(int argc, char *argv[]) {
   srand(time(NULL));
-  PythonGrpcClientGenerator generator;
-  return grpc::protobuf::compiler::PluginMain(argc, argv, &generator);
+  std::unique_ptr<AbstractGenerator> generator = NewPythonGrpcClientGenerator();
+  return grpc::protobuf::compiler::PluginMain(argc, argv, generator.get());
 }
@@ -41,28 +41,30 @@ import sys
 import itertools
 import subprocess
 import shutil
+from multiprocessing.pool import ThreadPool
 
 def run_and_wait(cmd):
   proc = subprocess.Popen(args=cmd)
   proc.wait()
 
 def run_and_check(cmd):
-  proc = subprocess.Popen(args=cmd)
-  ret = proc.wait()
-  if ret:
-    raise SystemExit(1)
+  # Raises subprocess.CalledProcessError rather than SystemExit, which a
+  # pool worker does not catch, leaving pool.map waiting forever.
+  subprocess.check_call(args=cmd)
 
 class CXXLanguage:
   def name(self):
     return "cpp"
-  def try_build(self, uniquename):
-    run_and_check(["bazel", "build", ":generated_" + uniquename + "_prober"])
+  def target(self, uniquename):
+    return ("//tmp/" + uniquename + "_" + self.name() +
+            ":generated_" + uniquename + "_prober")
 
 class GoLanguage:
   def name(self):
     return "go"
-  def try_build(self, uniquename):
-    run_and_check(["bazel", "build", ":generated_" + uniquename + "_prober"])
+  def target(self, uniquename):
+    return ("//tmp/" + uniquename + "_" + self.name() +
+            ":generated_" + uniquename + "_prober")
 
 
 _LANGUAGES = {
@@ -77,11 +79,19 @@ argp.add_argument('-l', '--language',
                   nargs='+',
                   default=['all'],
                   help='Clients languages to generate.')
+argp.add_argument('-j', '--jobs',
+                  type=int,
+                  default=0,
+                  help='number of generate.py jobs to run in parallel, '
+                       'defaults to the number of cpus')
+argp.add_argument('--generator_options',
+                  default="",
+                  help='comma separated options passed to the generator, '
+                       'e.g. populate_tables,split_services')
 
 args = argp.parse_args()
 
-languages = set(_LANGUAGES[l]
-                for l in itertools.chain.from_iterable(
+language_keys = set(itertools.chain.from_iterable(
                       _LANGUAGES.iterkeys() if x == 'all' else [x]
                       for x in args.language))
 
@@ -89,23 +99,33 @@ languages = set(_LANGUAGES[l]
 ROOT = os.path.abspath(os.path.dirname(sys.argv[0]))
 os.chdir(ROOT)
 
-if 'all' in args.language:
-  run_and_wait(["bazel", "build", ":all"])
-else:
-  for lang in languages:
-    run_and_wait(["bazel", "build", ":" + lang.name() + "_generator"])
+run_and_wait(["bazel", "build", ":multi_generator"])
 
-for filename in os.listdir('protos'):
-  os.chdir(ROOT)
+# every proto x language pair is generated by its own generate.py job. The
+# jobs only share the output directory, and write to distinct
+# subdirectories of it.
+jobs = []
+targets = []
+for filename in sorted(os.listdir('protos')):
   uniquename = filename[:-6]
-  run_and_wait(["python", "generate.py", "-p",
-      "protos/" + filename, "-d", "tmp", 
-      "--no-rebuild", "-l"] + args.language)
-
-  for lang in languages:
-    os.chdir(ROOT)
-    os.chdir("tmp/" + uniquename + "_" + lang.name())
-    lang.try_build(uniquename)
-
+  for key in sorted(language_keys):
+    jobs.append(["python", "generate.py", "-p",
+        "protos/" + filename, "-d", "tmp", 
+        "--no-rebuild", "-j", "1", "-l", key,
+        "--generator_options", args.generator_options])
+    targets.append(_LANGUAGES[key].target(uniquename))
+
+pool = ThreadPool(args.jobs or None)
+try:
+  pool.map(run_and_check, jobs)
+except subprocess.CalledProcessError as e:
+  print("ERROR: " + " ".join(e.cmd) + " failed")
+  raise SystemExit(1)
+finally:
+  pool.close()
+  pool.join()
+
+# one bazel invocation for everything, so bazel can schedule the builds
+run_and_check(["bazel", "build"] + targets)
 
 # shutil.rmtree("tmp")
@@ -0,0 +1,76 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "alias_sampler.h"
+
+#include <cmath>
+
+namespace grpc {
+
+AliasSampler::AliasSampler(const std::vector<double> &weights)
+    : threshold_(weights.size()), alias_(weights.size())
+{
+  size_t n = weights.size();
+  double total = 0;
+  for (size_t i = 0; i < n; ++i) total += weights[i];
+
+  // Scaled so that they average 1, the columns are filled by pairing one
+  // under 1 with one over 1, which gives the first what it lacks and is
+  // left with less itself.
+  std::vector<double> scaled(n);
+  std::vector<size_t> small, large;
+  for (size_t i = 0; i < n; ++i) {
+    scaled[i] = weights[i] * n / total;
+    alias_[i] = i;
+    (scaled[i] < 1 ? small : large).push_back(i);
+  }
+  while (!small.empty() && !large.empty()) {
+    size_t under = small.back();
+    small.pop_back();
+    size_t over = large.back();
+    large.pop_back();
+    threshold_[under] = static_cast<uint64_t>(std::ldexp(scaled[under], 32));
+    alias_[under] = over;
+    scaled[over] -= 1 - scaled[under];
+    (scaled[over] < 1 ? small : large).push_back(over);
+  }
+  // what is left is 1 up to rounding, a column of its own
+  for (size_t i = 0; i < small.size(); ++i) {
+    threshold_[small[i]] = uint64_t(1) << 32;
+  }
+  for (size_t i = 0; i < large.size(); ++i) {
+    threshold_[large[i]] = uint64_t(1) << 32;
+  }
+}
+
+}  // namespace grpc
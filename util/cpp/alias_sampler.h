@@ -0,0 +1,70 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef UTIL_ALIAS_SAMPLER
+#define UTIL_ALIAS_SAMPLER
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace grpc {
+
+// Draws indexes at random in proportion to their weights in constant time,
+// with Walker's alias method as built by Vose: every index gets a column
+// holding itself up to a threshold and one other, its alias, above it. A
+// draw picks a column and a point in it from the two halves of a single
+// 64-bit random number, so it costs a multiplication and a comparison
+// whatever the number of indexes.
+class AliasSampler {
+ public:
+  AliasSampler() {}
+  // The weights must not be negative and must not all be zero.
+  explicit AliasSampler(const std::vector<double> &weights);
+
+  size_t size() const { return alias_.size(); }
+  // Maps a uniformly distributed random number to an index.
+  size_t Sample(uint64_t random) const {
+    size_t column = static_cast<size_t>(((random & 0xffffffff) * size()) >> 32);
+    return (random >> 32) < threshold_[column] ? column : alias_[column];
+  }
+
+ private:
+  // of the upper half of a random number, out of 2^32
+  std::vector<uint64_t> threshold_;
+  std::vector<size_t> alias_;
+};
+
+}  // namespace grpc
+
+#endif  // UTIL_ALIAS_SAMPLER
@@ -34,21 +34,48 @@
 #include "create_prober_channel.h"
 
 #include <grpc++/create_channel.h>
+#include <grpc++/support/channel_arguments.h>
 
 #include "create_test_channel.h"
 
 namespace grpc {
 
-std::shared_ptr<Channel> CreateProberChannel(
-    const grpc::string& server, const int32_t port, 
-    const grpc::string& override_hostname, bool enable_ssl, bool use_test_ca)
+// Static helper. Creates a channel to server:port with the given channel
+// arguments.
+static std::shared_ptr<Channel> CreateChannel(
+    const grpc::string& server, const int32_t port,
+    const grpc::string& override_hostname, bool enable_ssl, bool use_test_ca,
+    const ChannelArguments& args)
 {
   const int host_port_buf_size = 1024;
   char host_port[host_port_buf_size];
   snprintf(host_port, host_port_buf_size, "%s:%d", server.c_str(), port);
   std::shared_ptr<CallCredentials> creds;
   return CreateTestChannel(host_port, override_hostname,
-                             enable_ssl, !use_test_ca, creds);
+                             enable_ssl, !use_test_ca, creds, args);
+}
+
+std::shared_ptr<Channel> CreateProberChannel(
+    const grpc::string& server, const int32_t port, 
+    const grpc::string& override_hostname, bool enable_ssl, bool use_test_ca)
+{
+  return CreateChannel(server, port, override_hostname, enable_ssl,
+                       use_test_ca, ChannelArguments());
+}
+
+std::vector<std::shared_ptr<Channel> > CreateProberChannels(
+    const grpc::string& server, const int32_t port,
+    const grpc::string& override_hostname, bool enable_ssl, bool use_test_ca,
+    int num_channels)
+{
+  std::vector<std::shared_ptr<Channel> > channels;
+  for (int i = 0; i < num_channels; ++i) {
+    ChannelArguments args;
+    args.SetInt("grpc.prober_channel_id", i);
+    channels.push_back(CreateChannel(server, port, override_hostname,
+                                     enable_ssl, use_test_ca, args));
+  }
+  return channels;
 }
 
 }  // namespace grpc
@@ -35,6 +35,7 @@
 #define UTIL_CREATE_PROBER_CHANNEL
 
 #include <memory>
+#include <vector>
 #include <grpc++/support/string_ref.h>
 
 namespace grpc {
@@ -44,6 +45,14 @@ std::shared_ptr<Channel> CreateProberChannel(
     const grpc::string& server, const int32_t port, 
     const grpc::string& override_hostname, bool enable_ssl, bool use_test_ca);
 
+// Creates num_channels channels to the server that each get a connection
+// of their own. gRPC shares a connection between channels with the same
+// arguments, so every channel gets a distinct channel id argument.
+std::vector<std::shared_ptr<Channel> > CreateProberChannels(
+    const grpc::string& server, const int32_t port,
+    const grpc::string& override_hostname, bool enable_ssl, bool use_test_ca,
+    int num_channels);
+
 }  // namespace grpc
 
 #endif  // UTIL_CREATE_PROBER_CHANNEL
@@ -0,0 +1,121 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef UTIL_DUPLEX_STREAMS
+#define UTIL_DUPLEX_STREAMS
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <grpc++/client_context.h>
+#include <grpc++/support/status.h>
+#include <grpc++/support/sync_stream.h>
+
+#include "stream_stats.h"
+
+namespace grpc {
+
+// Opens stream i of a throughput probe on the given context, e.g. with
+// stubs[i % stubs.size()]->RouteChat(context).
+template <class Request, class Response>
+using DuplexStreamOpener =
+    std::function<std::unique_ptr<ClientReaderWriter<Request, Response> >(
+        size_t i, ClientContext *context)>;
+
+// Measures the throughput of a bidirectional streaming method through the
+// blocking API. Opens streams streams, and gives each a thread writing
+// request over and over and a thread reading whatever comes back, so that
+// neither direction waits for the other. After seconds, or when the server
+// ends them with no limit, the writers half-close the streams and the
+// readers read them to the end.
+template <class Request, class Response>
+DuplexStats RunDuplexStreams(const Request &request, size_t streams,
+                             double seconds,
+                             DuplexStreamOpener<Request, Response> open)
+{
+  typedef std::chrono::steady_clock clock;
+  struct Stream {
+    ClientContext context;
+    std::unique_ptr<ClientReaderWriter<Request, Response> > stream;
+    int64_t sent = 0;
+    int64_t received = 0;
+    int64_t received_bytes = 0;
+  };
+
+  DuplexStats stats;
+  clock::time_point deadline =
+      seconds > 0 ? clock::now() + std::chrono::duration_cast<clock::duration>(
+                                       std::chrono::duration<double>(seconds))
+                  : clock::time_point::max();
+  std::vector<std::unique_ptr<Stream> > all;
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < streams; ++i) {
+    all.emplace_back(new Stream);
+    Stream *s = all.back().get();
+    s->stream = open(i, &s->context);
+    threads.emplace_back([s, &request, deadline]() {
+      while (clock::now() < deadline && s->stream->Write(request)) {
+        ++s->sent;
+      }
+      s->stream->WritesDone();
+    });
+    threads.emplace_back([s]() {
+      Response response;
+      while (s->stream->Read(&response)) {
+        ++s->received;
+        s->received_bytes += response.ByteSizeLong();
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  stats.Finish();
+
+  int64_t size = request.ByteSizeLong();
+  for (const std::unique_ptr<Stream> &s : all) {
+    Status status = s->stream->Finish();
+    stats.Add(s->sent, s->sent * size, s->received, s->received_bytes,
+              status.ok());
+  }
+  return stats;
+}
+
+}  // namespace grpc
+
+#endif  // UTIL_DUPLEX_STREAMS
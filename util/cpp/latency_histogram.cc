@@ -0,0 +1,190 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <mutex>
+
+namespace grpc {
+
+LatencyHistogram::LatencyHistogram() : count_(0), max_(0)
+{
+  std::fill(std::begin(counts_), std::end(counts_), 0);
+}
+
+int LatencyHistogram::BucketOf(int64_t nanos)
+{
+  const int64_t linear = 2 << kSubBucketBits;
+  if (nanos < 0) nanos = 0;
+  if (nanos < linear) return static_cast<int>(nanos);
+  nanos = std::min<int64_t>(nanos, (int64_t(2) << kMaxBits) - 1);
+  // above the linear range, shift the value down to its top bits: their
+  // number picks the power of two, the bits themselves the bucket in it
+  int shift = 63 - __builtin_clzll(nanos) - kSubBucketBits;
+  return (shift << kSubBucketBits) + static_cast<int>(nanos >> shift);
+}
+
+int64_t LatencyHistogram::BucketEnd(int bucket)
+{
+  const int linear = 2 << kSubBucketBits;
+  if (bucket < linear) return bucket;
+  int shift = (bucket >> kSubBucketBits) - 1;
+  int64_t top = bucket - (shift << kSubBucketBits);
+  return ((top + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(int64_t nanos)
+{
+  ++counts_[BucketOf(nanos)];
+  ++count_;
+  if (nanos > max_) max_ = nanos;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram &other)
+{
+  for (int i = 0; i < kBuckets; ++i) {
+    counts_[i] += other.counts_[i];
+  }
+  count_ += other.count_;
+  max_ = std::max(max_, other.max_);
+}
+
+int64_t LatencyHistogram::Percentile(double quantile) const
+{
+  if (count_ == 0) return 0;
+  int64_t rank = static_cast<int64_t>(quantile * count_ + 0.5);
+  rank = std::max<int64_t>(1, std::min(rank, count_));
+  int64_t seen = 0;
+  for (int i = 0; i < kBuckets; ++i) {
+    seen += counts_[i];
+    if (seen >= rank) return std::min(BucketEnd(i), max_);
+  }
+  return max_;
+}
+
+void PrintLatencyPercentiles(const LatencyHistogram &histogram,
+                             std::ostream &out)
+{
+  static const struct {
+    const char *name;
+    double quantile;
+  } percentiles[] = {{"p50", 0.5}, {"p90", 0.9}, {"p99", 0.99},
+                     {"p99.9", 0.999}};
+  for (auto it = std::begin(percentiles); it != std::end(percentiles);
+       ++it) {
+    out << it->name << " " << histogram.Percentile(it->quantile) / 1e6
+        << "ms ";
+  }
+  out << "max " << histogram.max() / 1e6 << "ms";
+}
+
+namespace {
+
+// The histograms of one thread, by method id, made on first use.
+typedef std::vector<std::unique_ptr<LatencyHistogram> > ThreadLatencies;
+
+// Owns the histograms of every thread that recorded, so that they outlive
+// the threads.
+struct LatencyRegistry {
+  std::mutex mu;
+  std::vector<grpc::string> names;
+  std::vector<std::unique_ptr<ThreadLatencies> > threads;
+};
+
+LatencyRegistry &Registry()
+{
+  static LatencyRegistry *registry = new LatencyRegistry;
+  return *registry;
+}
+
+thread_local ThreadLatencies *thread_latencies = nullptr;
+
+}  // namespace
+
+int RegisterLatencyMethod(const grpc::string &name)
+{
+  LatencyRegistry &registry = Registry();
+  std::lock_guard<std::mutex> lock(registry.mu);
+  registry.names.push_back(name);
+  return static_cast<int>(registry.names.size() - 1);
+}
+
+void RecordLatency(int method, std::chrono::nanoseconds latency)
+{
+  if (thread_latencies == nullptr) {
+    LatencyRegistry &registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.mu);
+    registry.threads.emplace_back(new ThreadLatencies);
+    thread_latencies = registry.threads.back().get();
+  }
+  if (static_cast<size_t>(method) >= thread_latencies->size()) {
+    thread_latencies->resize(method + 1);
+  }
+  std::unique_ptr<LatencyHistogram> &histogram = (*thread_latencies)[method];
+  if (!histogram) histogram.reset(new LatencyHistogram);
+  histogram->Record(latency.count());
+}
+
+std::vector<std::pair<grpc::string, LatencyHistogram> > MergeLatencies()
+{
+  LatencyRegistry &registry = Registry();
+  std::lock_guard<std::mutex> lock(registry.mu);
+  std::vector<std::pair<grpc::string, LatencyHistogram> > merged;
+  for (auto it = registry.names.begin(); it != registry.names.end(); ++it) {
+    merged.push_back(std::make_pair(*it, LatencyHistogram()));
+  }
+  for (auto thread = registry.threads.begin();
+       thread != registry.threads.end(); ++thread) {
+    for (size_t i = 0; i < (*thread)->size(); ++i) {
+      if ((**thread)[i]) merged[i].second.Merge(*(**thread)[i]);
+    }
+  }
+  return merged;
+}
+
+void PrintLatencies(std::ostream &out)
+{
+  std::vector<std::pair<grpc::string, LatencyHistogram> > merged =
+      MergeLatencies();
+  for (auto it = merged.begin(); it != merged.end(); ++it) {
+    if (it->second.count() == 0) continue;
+    out << "\t" << it->first << ": " << it->second.count() << " RPCs, ";
+    PrintLatencyPercentiles(it->second, out);
+    out << std::endl;
+  }
+}
+
+}  // namespace grpc
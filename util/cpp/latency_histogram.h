@@ -0,0 +1,100 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef UTIL_LATENCY_HISTOGRAM
+#define UTIL_LATENCY_HISTOGRAM
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include <grpc++/support/config.h>
+
+namespace grpc {
+
+// A fixed-size log-linear histogram of latencies in nanoseconds, in the
+// style of HdrHistogram: every power of two is split into 32 linear
+// buckets, so percentiles are within about 3% of the recorded values.
+// Latencies up to 2^41ns, about 36 minutes, are told apart.
+class LatencyHistogram {
+ public:
+  LatencyHistogram();
+
+  void Record(int64_t nanos);
+  void Merge(const LatencyHistogram &other);
+
+  int64_t count() const { return count_; }
+  int64_t max() const { return max_; }
+  // The latency at or below which the given fraction of the recorded ones
+  // fall, rounded up to the end of its bucket.
+  int64_t Percentile(double quantile) const;
+
+ private:
+  static const int kSubBucketBits = 5;
+  static const int kMaxBits = 40;
+  static const int kBuckets = (kMaxBits - kSubBucketBits + 2)
+                              << kSubBucketBits;
+
+  static int BucketOf(int64_t nanos);
+  static int64_t BucketEnd(int bucket);
+
+  int64_t counts_[kBuckets];
+  int64_t count_;
+  int64_t max_;
+};
+
+// Prints the p50, p90, p99, p99.9 and max of a histogram in milliseconds.
+void PrintLatencyPercentiles(const LatencyHistogram &histogram,
+                             std::ostream &out);
+
+// Latencies of named methods, recorded from any thread. Every thread
+// records into histograms of its own, so that after a thread's first
+// latency of a method, recording takes no lock and no atomic operation.
+
+// Returns the id to record the latencies of the method called name under.
+int RegisterLatencyMethod(const grpc::string &name);
+
+void RecordLatency(int method, std::chrono::nanoseconds latency);
+
+// Sums the histograms of all threads by method. Only call it once the
+// threads are done recording.
+std::vector<std::pair<grpc::string, LatencyHistogram> > MergeLatencies();
+
+// Prints the merged percentiles of every method with latencies.
+void PrintLatencies(std::ostream &out);
+
+}  // namespace grpc
+
+#endif  // UTIL_LATENCY_HISTOGRAM
@@ -0,0 +1,164 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "latency_histogram.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+namespace grpc {
+namespace {
+
+#define EXPECT(condition)                                                 \
+  do {                                                                    \
+    if (!(condition)) {                                                   \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": " #condition         \
+                << std::endl;                                             \
+      std::exit(1);                                                       \
+    }                                                                     \
+  } while (0)
+
+// Every power of two is split into 32 buckets.
+const double kRelativeError = 1.0 / 32;
+// the largest latency told apart from larger ones
+const int64_t kLargest = (int64_t(1) << 41) - 1;
+
+// Whether reported is at least value, by at most the relative error.
+bool Within(int64_t value, int64_t reported) {
+  return reported >= value && reported <= value + value * kRelativeError;
+}
+
+// A value alone below a much larger one is reported as the end of its
+// bucket, which must hold it and be at most 1/32 above it: exactly below
+// 64, then on either side of every power of two.
+void TestBuckets() {
+  std::vector<int64_t> values;
+  for (int64_t v = 0; v <= 200; ++v) values.push_back(v);
+  for (int bits = 7; bits <= 41; ++bits) {
+    int64_t power = int64_t(1) << bits;
+    values.push_back(power - 1);
+    values.push_back(power);
+    values.push_back(power + 1);
+    values.push_back(power + power / 3);
+  }
+  for (auto it = values.begin(); it != values.end(); ++it) {
+    if (*it > kLargest) continue;
+    LatencyHistogram histogram;
+    histogram.Record(*it);
+    histogram.Record(int64_t(1) << 50);
+    int64_t reported = histogram.Percentile(0.5);
+    if (*it < 64) {
+      EXPECT(reported == *it);
+    } else {
+      EXPECT(Within(*it, reported));
+    }
+  }
+
+  // beyond the largest bucket only max is exact
+  LatencyHistogram huge;
+  huge.Record(0);
+  huge.Record(int64_t(1) << 50);
+  EXPECT(huge.Percentile(0.5) == 0);
+  EXPECT(huge.Percentile(1) == kLargest);
+  EXPECT(huge.max() == int64_t(1) << 50);
+  EXPECT(huge.count() == 2);
+
+  // negative latencies count as 0, an empty histogram reports 0
+  LatencyHistogram negative;
+  negative.Record(-5);
+  EXPECT(negative.Percentile(0.5) == 0);
+  EXPECT(LatencyHistogram().Percentile(0.99) == 0);
+}
+
+// Latencies of 1 to 100000us, so that the exact percentiles are known.
+void TestPercentiles() {
+  LatencyHistogram histogram;
+  for (int64_t i = 1; i <= 100000; ++i) histogram.Record(i * 1000);
+  EXPECT(histogram.count() == 100000);
+  EXPECT(Within(50000 * 1000, histogram.Percentile(0.5)));
+  EXPECT(Within(90000 * 1000, histogram.Percentile(0.9)));
+  EXPECT(Within(99000 * 1000, histogram.Percentile(0.99)));
+  EXPECT(Within(99900 * 1000, histogram.Percentile(0.999)));
+  EXPECT(histogram.max() == 100000 * 1000);
+  // the end of the last bucket is beyond max, which is reported instead
+  EXPECT(histogram.Percentile(1) == histogram.max());
+}
+
+// Spreading the same latencies over threads and merging them gives what
+// recording them all in one histogram gives.
+void TestMerge() {
+  const int kThreads = 4;
+  const int64_t kPerThread = 50000;
+  LatencyHistogram all;
+  for (int64_t i = 0; i < kThreads * kPerThread; ++i) all.Record(i * 37);
+
+  LatencyHistogram merged;
+  std::vector<LatencyHistogram> parts(kThreads);
+  int method = RegisterLatencyMethod("Merge");
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int64_t i = t; i < kThreads * kPerThread; i += kThreads) {
+        parts[t].Record(i * 37);
+        RecordLatency(method, std::chrono::nanoseconds(i * 37));
+      }
+    });
+  }
+  for (auto it = threads.begin(); it != threads.end(); ++it) it->join();
+  for (int t = 0; t < kThreads; ++t) merged.Merge(parts[t]);
+
+  std::vector<std::pair<grpc::string, LatencyHistogram> > registered =
+      MergeLatencies();
+  EXPECT(registered.size() == static_cast<size_t>(method) + 1);
+  EXPECT(registered[method].first == "Merge");
+  const LatencyHistogram *results[] = {&merged, &registered[method].second};
+  for (auto it = std::begin(results); it != std::end(results); ++it) {
+    EXPECT((*it)->count() == all.count());
+    EXPECT((*it)->max() == all.max());
+    for (double q = 0; q <= 1; q += 0.001) {
+      EXPECT((*it)->Percentile(q) == all.Percentile(q));
+    }
+  }
+}
+
+}  // namespace
+}  // namespace grpc
+
+int main() {
+  grpc::TestBuckets();
+  grpc::TestPercentiles();
+  grpc::TestMerge();
+  std::cout << "PASSED" << std::endl;
+  return 0;
+}
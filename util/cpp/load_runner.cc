@@ -0,0 +1,652 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "load_runner.h"
+
+#include <grpc++/generic/generic_stub.h>
+#include <grpc++/support/slice.h>
+
+#include "method_picker.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+
+namespace grpc {
+
+GenericLoadCall::GenericLoadCall(std::shared_ptr<Channel> channel,
+                                 const grpc::string &path,
+                                 const google::protobuf::Message &request,
+                                 const google::protobuf::Message &response)
+    : channel(channel), path(path), response(&response)
+{
+  grpc::string bytes = request.SerializeAsString();
+  Slice slice(bytes);
+  this->request = ByteBuffer(&slice, 1);
+}
+
+namespace {
+
+typedef std::chrono::steady_clock clock;
+typedef std::vector<LoadStats::Method> Counts;
+
+// Shared by the threads of a run: when to stop, and how many RPCs were
+// started so far when there is a limit.
+class LoadLimit {
+ public:
+  explicit LoadLimit(const LoadOptions &options)
+      : start_(clock::now()),
+        deadline_(clock::time_point::max()),
+        max_rpcs_(options.max_rpcs),
+        issued_(0) {
+    double duration = options.duration_seconds;
+    if (duration <= 0 && max_rpcs_ <= 0) duration = 10;
+    if (duration > 0) {
+      deadline_ = start_ + std::chrono::duration_cast<clock::duration>(
+                               std::chrono::duration<double>(duration));
+    }
+  }
+
+  // Whether one more RPC may be started, counting it if so.
+  bool Reserve() {
+    if (clock::now() >= deadline_) return false;
+    return max_rpcs_ <= 0 ||
+           issued_.fetch_add(1, std::memory_order_relaxed) < max_rpcs_;
+  }
+
+  // Whether the run is over, without counting an RPC. For the threads that
+  // wait for a method under its limit rather than calling Reserve.
+  bool Over() const {
+    return clock::now() >= deadline_ ||
+           (max_rpcs_ > 0 &&
+            issued_.load(std::memory_order_relaxed) >= max_rpcs_);
+  }
+
+  double Elapsed() const {
+    return std::chrono::duration<double>(clock::now() - start_).count();
+  }
+
+ private:
+  clock::time_point start_;
+  clock::time_point deadline_;
+  int64_t max_rpcs_;
+  std::atomic<int64_t> issued_;
+};
+
+// How long to wait before trying again when every method is at its
+// max_in_flight and no RPC of the waiting thread is in flight either.
+const clock::duration kLimitedWait = std::chrono::milliseconds(1);
+
+std::chrono::nanoseconds DeadlineOf(const LoadMethod &method) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::duration<double>(method.deadline_seconds));
+}
+
+void Count(LoadStats::Method *method, bool ok, clock::duration latency) {
+  ++method->rpcs;
+  if (!ok) ++method->errors;
+  method->latency.Record(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+}
+
+// Adds the counts of from to into, which must be of the same method.
+void Merge(LoadStats::Method *into, const LoadStats::Method &from) {
+  into->rpcs += from.rpcs;
+  into->errors += from.errors;
+  into->latency.Merge(from.latency);
+  into->response_bytes += from.response_bytes;
+  if (from.hashed > 0) {
+    if (into->hashed == 0 || from.min_hash < into->min_hash) {
+      into->min_hash = from.min_hash;
+    }
+    if (into->hashed == 0 || from.max_hash > into->max_hash) {
+      into->max_hash = from.max_hash;
+    }
+    into->hashed += from.hashed;
+  }
+  into->parsed += from.parsed;
+  into->parse_errors += from.parse_errors;
+}
+
+void RunSyncLoad(const std::vector<LoadMethod> &methods, int concurrency,
+                 MethodPicker *picker, LoadLimit *limit,
+                 std::vector<Counts> *counts)
+{
+  std::vector<std::thread> threads;
+  for (int t = 0; t < concurrency; ++t) {
+    threads.emplace_back([&, t]() {
+      Counts &mine = (*counts)[t];
+      MethodPicker::Cursor cursor = picker->NewCursor(t);
+      size_t next = MethodPicker::kNone;
+      while (true) {
+        next = picker->Pick(&cursor, next);
+        if (next == MethodPicker::kNone) {
+          if (limit->Over()) break;
+          std::this_thread::sleep_for(kLimitedWait);
+          continue;
+        }
+        if (!limit->Reserve()) break;
+        ClientContext context;
+        if (methods[next].deadline_seconds > 0) {
+          context.set_deadline(std::chrono::system_clock::now() +
+                               DeadlineOf(methods[next]));
+        }
+        clock::time_point sent = clock::now();
+        bool ok = methods[next].call(&context).ok();
+        Count(&mine[next], ok, clock::now() - sent);
+      }
+      picker->Release(next);
+    });
+  }
+  for (auto it = threads.begin(); it != threads.end(); ++it) {
+    it->join();
+  }
+}
+
+// When a completion queue sends its next RPC: right away in a closed loop,
+// at its share of the target QPS in an open one.
+class SendSchedule {
+ public:
+  SendSchedule(const LoadOptions &options, int queues, int queue)
+      : rate_(options.target_qps / queues),
+        poisson_(options.poisson),
+        random_(std::random_device()() + queue),
+        next_(clock::now()) {
+    Advance();
+  }
+
+  bool open() const { return rate_ > 0; }
+  clock::time_point next() const { return next_; }
+
+  // Moves next() on by one send. A closed loop has no rate to pace by,
+  // so it is left alone rather than dividing by zero.
+  void Advance() {
+    if (!open()) return;
+    double gap = 1 / rate_;
+    if (poisson_) gap = std::exponential_distribution<double>(rate_)(random_);
+    next_ += std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<double>(gap));
+  }
+
+ private:
+  double rate_;
+  bool poisson_;
+  std::mt19937_64 random_;
+  clock::time_point next_;
+};
+
+// The response of a generic call, kept as the bytes that came back.
+class GenericResponse {
+ public:
+  explicit GenericResponse(const GenericLoadCall &generic)
+      : generic_(generic), parse_credit_(1) {}
+
+  ByteBuffer *buffer() { return &buffer_; }
+
+  // Counts the bytes of a successful response into method, hashes them
+  // with hash_responses, and parses parse_sample_rate of the responses.
+  // The first response is always parsed.
+  void Record(const LoadOptions &options, LoadStats::Method *method) {
+    method->response_bytes += buffer_.Length();
+    bool parse = false;
+    if (options.parse_sample_rate > 0 && generic_.response != nullptr) {
+      parse_credit_ += options.parse_sample_rate;
+      if (parse_credit_ >= 1) {
+        parse_credit_ -= 1;
+        parse = true;
+      }
+    }
+    if (!options.hash_responses && !parse) return;
+    // a response without any bytes may have come back as no buffer at all
+    if (!buffer_.Dump(&slices_).ok()) slices_.clear();
+
+    if (options.hash_responses) {
+      // FNV-1a over the bytes of every slice in turn
+      uint64_t hash = 14695981039346656037ull;
+      for (auto it = slices_.begin(); it != slices_.end(); ++it) {
+        const uint8_t *bytes = it->begin();
+        for (size_t i = 0; i < it->size(); ++i) {
+          hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+      }
+      if (method->hashed == 0 || hash < method->min_hash) {
+        method->min_hash = hash;
+      }
+      if (method->hashed == 0 || hash > method->max_hash) {
+        method->max_hash = hash;
+      }
+      ++method->hashed;
+    }
+    if (parse) {
+      bytes_.clear();
+      for (auto it = slices_.begin(); it != slices_.end(); ++it) {
+        bytes_.append(reinterpret_cast<const char *>(it->begin()),
+                      it->size());
+      }
+      if (!parsed_) parsed_.reset(generic_.response->New());
+      ++method->parsed;
+      if (!parsed_->ParseFromString(bytes_)) ++method->parse_errors;
+    }
+  }
+
+ private:
+  const GenericLoadCall &generic_;
+  ByteBuffer buffer_;
+  // reused from response to response
+  std::vector<Slice> slices_;
+  grpc::string bytes_;
+  std::unique_ptr<google::protobuf::Message> parsed_;
+  // parse the next response when this reaches 1
+  double parse_credit_;
+};
+
+// The AsyncCall of the generic engine. Copying the request buffer into a
+// call only takes references on its slices.
+class GenericAsyncCall : public AsyncCall {
+ public:
+  explicit GenericAsyncCall(const GenericLoadCall &generic)
+      : generic_(generic), stub_(generic.channel), response_(generic) {}
+
+  void Start(CompletionQueue *cq, void *tag) override {
+    reader_.reset();
+    context_.~ClientContext();
+    new (&context_) ClientContext();
+    SetDeadline(&context_);
+
+    reader_ = stub_.PrepareUnaryCall(&context_, generic_.path,
+                                     generic_.request, cq);
+    reader_->StartCall();
+    reader_->Finish(response_.buffer(), &status_, tag);
+  }
+
+  const Status &status() const override { return status_; }
+  GenericResponse *response() { return &response_; }
+
+ private:
+  const GenericLoadCall &generic_;
+  GenericStub stub_;
+  GenericResponse response_;
+  Status status_;
+  ClientContext context_;
+  std::unique_ptr<ClientAsyncResponseReader<ByteBuffer> > reader_;
+};
+
+// The CallbackCall of the generic engine.
+class GenericCallbackCall : public CallbackCall {
+ public:
+  explicit GenericCallbackCall(const GenericLoadCall &generic)
+      : generic_(generic), stub_(generic.channel), response_(generic) {}
+
+  void Start() override {
+    context_.~ClientContext();
+    new (&context_) ClientContext();
+    SetDeadline(&context_);
+    stub_.UnaryCall(&context_, generic_.path, StubOptions(),
+                    &generic_.request, response_.buffer(),
+                    [this](Status status) { done_(status); });
+  }
+
+  GenericResponse *response() { return &response_; }
+
+ private:
+  const GenericLoadCall &generic_;
+  GenericStub stub_;
+  GenericResponse response_;
+  ClientContext context_;
+};
+
+// A pooled call of the async engine, used as its own tag.
+struct AsyncSlot {
+  size_t method;
+  std::unique_ptr<AsyncCall> call;
+  // when the RPC was due to be sent
+  clock::time_point scheduled;
+};
+
+void RunAsyncQueue(const std::vector<LoadMethod> &methods,
+                   const LoadOptions &options, int queues, int queue,
+                   MethodPicker *picker, LoadLimit *limit, Counts *counts)
+{
+  int outstanding =
+      options.outstanding_rpcs > 0 ? options.outstanding_rpcs : 1;
+  CompletionQueue cq;
+  SendSchedule schedule(options, queues, queue);
+  // The calls are made as the methods first need them, at most outstanding
+  // of them, and then reused.
+  std::deque<AsyncSlot> slots;
+  std::vector<std::vector<AsyncSlot *> > free(methods.size());
+  MethodPicker::Cursor cursor = picker->NewCursor(queue);
+  int in_flight = 0;
+  bool sending = true;
+
+  while (true) {
+    clock::time_point now = clock::now();
+    // whether every method is at its max_in_flight
+    bool limited = false;
+    while (sending && in_flight < outstanding &&
+           (!schedule.open() || schedule.next() <= now)) {
+      size_t next_method = picker->Pick(&cursor, MethodPicker::kNone);
+      if (next_method == MethodPicker::kNone) {
+        if (limit->Over()) {
+          sending = false;
+        } else {
+          limited = true;
+        }
+        break;
+      }
+      if (!limit->Reserve()) {
+        picker->Release(next_method);
+        sending = false;
+        break;
+      }
+      std::vector<AsyncSlot *> &pool = free[next_method];
+      AsyncSlot *slot;
+      if (pool.empty()) {
+        slots.emplace_back();
+        slot = &slots.back();
+        slot->method = next_method;
+        if (options.generic) {
+          slot->call.reset(
+              new GenericAsyncCall(methods[next_method].generic));
+        } else {
+          slot->call = methods[next_method].new_async_call();
+        }
+        slot->call->set_deadline(DeadlineOf(methods[next_method]));
+      } else {
+        slot = pool.back();
+        pool.pop_back();
+      }
+      slot->scheduled = schedule.open() ? schedule.next() : now;
+      slot->call->Start(&cq, slot);
+      ++in_flight;
+      schedule.Advance();
+    }
+    if (in_flight == 0 && !sending) break;
+
+    void *tag;
+    bool ok;
+    if (sending && in_flight < outstanding && !(limited && in_flight > 0)) {
+      // wake up in time for the next send, or to look for a method under
+      // its limit again when none of ours will complete
+      clock::time_point next =
+          limited ? clock::now() + kLimitedWait : schedule.next();
+      std::chrono::system_clock::time_point wakeup =
+          std::chrono::system_clock::now() +
+          std::chrono::duration_cast<std::chrono::system_clock::duration>(
+              next - clock::now());
+      if (cq.AsyncNext(&tag, &ok, wakeup) != CompletionQueue::GOT_EVENT) {
+        continue;
+      }
+    } else if (!cq.Next(&tag, &ok)) {
+      break;
+    }
+    AsyncSlot *slot = static_cast<AsyncSlot *>(tag);
+    LoadStats::Method *method = &(*counts)[slot->method];
+    ok = ok && slot->call->status().ok();
+    Count(method, ok, clock::now() - slot->scheduled);
+    if (ok && options.generic) {
+      static_cast<GenericAsyncCall *>(slot->call.get())
+          ->response()
+          ->Record(options, method);
+    }
+    free[slot->method].push_back(slot);
+    picker->Release(slot->method);
+    --in_flight;
+  }
+
+  cq.Shutdown();
+  void *tag;
+  bool ok;
+  while (cq.Next(&tag, &ok)) {
+  }
+}
+
+void RunAsyncLoad(const std::vector<LoadMethod> &methods,
+                  const LoadOptions &options, int queues,
+                  MethodPicker *picker, LoadLimit *limit,
+                  std::vector<Counts> *counts)
+{
+  std::vector<std::thread> threads;
+  for (int q = 0; q < queues; ++q) {
+    threads.emplace_back([&, q]() {
+      RunAsyncQueue(methods, options, queues, q, picker, limit,
+                    &(*counts)[q]);
+    });
+  }
+  for (auto it = threads.begin(); it != threads.end(); ++it) {
+    it->join();
+  }
+}
+
+// A pooled call of the callback engine and what it counts into. Like the
+// threads of the other engines it picks the method of every RPC, and makes
+// the calls of the methods it picks as it first needs them.
+struct CallbackSlot {
+  size_t method;
+  // by method
+  std::vector<std::unique_ptr<CallbackCall> > calls;
+  MethodPicker::Cursor cursor;
+  std::function<void(const Status &)> done;
+  clock::time_point sent;
+};
+
+void RunCallbackLoad(const std::vector<LoadMethod> &methods, int calls,
+                     const LoadOptions &options, MethodPicker *picker,
+                     LoadLimit *limit, std::vector<Counts> *counts)
+{
+  std::mutex mu;
+  std::condition_variable finished;
+  int active = 0;
+  auto start = [&](CallbackSlot *slot, clock::time_point now) {
+    const LoadMethod &method = methods[slot->method];
+    std::unique_ptr<CallbackCall> &call = slot->calls[slot->method];
+    if (!call) {
+      if (options.generic) {
+        call.reset(new GenericCallbackCall(method.generic));
+      } else {
+        call = method.new_callback_call();
+      }
+      call->set_done(slot->done);
+      call->set_deadline(DeadlineOf(method));
+    }
+    slot->sent = now;
+    call->Start();
+  };
+
+  std::vector<CallbackSlot> slots(calls);
+  for (int i = 0; i < calls; ++i) {
+    CallbackSlot *slot = &slots[i];
+    slot->calls.resize(methods.size());
+    slot->cursor = picker->NewCursor(i);
+    // a slot only makes one RPC at a time, so it can have counts of its own
+    Counts *mine = &(*counts)[i];
+    slot->done = [&, slot, mine](const Status &status) {
+      clock::time_point now = clock::now();
+      LoadStats::Method *method = &(*mine)[slot->method];
+      Count(method, status.ok(), now - slot->sent);
+      if (status.ok() && options.generic) {
+        static_cast<GenericCallbackCall *>(slot->calls[slot->method].get())
+            ->response()
+            ->Record(options, method);
+      }
+      if (limit->Reserve()) {
+        // never kNone, the slot can go on with its method
+        slot->method = picker->Pick(&slot->cursor, slot->method);
+        start(slot, now);
+        return;
+      }
+      picker->Release(slot->method);
+      std::lock_guard<std::mutex> lock(mu);
+      if (--active == 0) finished.notify_one();
+    };
+  }
+
+  // Reserve all the first RPCs before any completion can look at active.
+  // The slots left without a method when all are at their limit stay idle.
+  int started = 0;
+  while (started < calls) {
+    CallbackSlot *slot = &slots[started];
+    slot->method = picker->Pick(&slot->cursor, MethodPicker::kNone);
+    if (slot->method == MethodPicker::kNone) break;
+    if (!limit->Reserve()) {
+      picker->Release(slot->method);
+      break;
+    }
+    ++started;
+  }
+  active = started;
+  for (int i = 0; i < started; ++i) {
+    start(&slots[i], clock::now());
+  }
+
+  std::unique_lock<std::mutex> lock(mu);
+  finished.wait(lock, [&active]() { return active == 0; });
+}
+
+}  // namespace
+
+LoadStats RunLoad(const std::vector<LoadMethod> &methods,
+                  const LoadOptions &options)
+{
+  LoadStats stats;
+  stats.rpcs = stats.errors = 0;
+  stats.seconds = 0;
+  if (methods.empty()) return stats;
+
+  bool async = options.async || options.target_qps > 0 ||
+               (options.generic && !options.callback);
+  int threads = options.concurrency;
+  if (threads <= 0 && async) {
+    threads = std::thread::hardware_concurrency();
+  }
+  if (threads <= 0) threads = 1;
+
+  // every thread counts into its own slots, summed once they are done
+  Counts totals;
+  for (auto it = methods.begin(); it != methods.end(); ++it) {
+    LoadStats::Method method = {it->name, 0, 0};
+    totals.push_back(method);
+  }
+  std::vector<Counts> counts(threads, totals);
+  MethodPicker picker(methods, options);
+  LoadLimit limit(options);
+  if (async) {
+    RunAsyncLoad(methods, options, threads, &picker, &limit, &counts);
+  } else if (options.callback) {
+    RunCallbackLoad(methods, threads, options, &picker, &limit, &counts);
+  } else {
+    RunSyncLoad(methods, threads, &picker, &limit, &counts);
+  }
+  stats.seconds = limit.Elapsed();
+
+  for (auto thread = counts.begin(); thread != counts.end(); ++thread) {
+    for (size_t i = 0; i < thread->size(); ++i) {
+      Merge(&totals[i], (*thread)[i]);
+    }
+  }
+
+  // then fold the channels of every method together, and the methods of
+  // every channel
+  std::map<grpc::string, size_t> method_index;
+  for (size_t i = 0; i < totals.size(); ++i) {
+    auto found = method_index.find(totals[i].name);
+    if (found == method_index.end()) {
+      found = method_index.insert(std::make_pair(totals[i].name,
+                                                 stats.methods.size())).first;
+      LoadStats::Method method = {totals[i].name, 0, 0};
+      stats.methods.push_back(method);
+    }
+    Merge(&stats.methods[found->second], totals[i]);
+
+    size_t channel = methods[i].channel;
+    if (channel >= stats.channels.size()) {
+      LoadStats::Channel empty = {0, 0};
+      stats.channels.resize(channel + 1, empty);
+    }
+    stats.channels[channel].rpcs += totals[i].rpcs;
+    stats.channels[channel].errors += totals[i].errors;
+
+    stats.rpcs += totals[i].rpcs;
+    stats.errors += totals[i].errors;
+  }
+  return stats;
+}
+
+void PrintLoadStats(const LoadStats &stats, std::ostream &out)
+{
+  double qps = stats.seconds > 0 ? stats.rpcs / stats.seconds : 0;
+  out << "Load finished: " << stats.rpcs << " RPCs, " << stats.errors
+      << " errors in " << stats.seconds << "s, " << qps << " QPS"
+      << std::endl;
+  for (auto it = stats.methods.begin(); it != stats.methods.end(); ++it) {
+    out << "\t" << it->name << ": " << it->rpcs << " RPCs, " << it->errors
+        << " errors";
+    if (it->latency.count() > 0) {
+      out << ", latency ";
+      PrintLatencyPercentiles(it->latency, out);
+    }
+    out << std::endl;
+    int64_t responses = it->rpcs - it->errors;
+    if (it->response_bytes > 0 || it->hashed > 0 || it->parsed > 0) {
+      out << "\t\tresponses: "
+          << (responses > 0 ? it->response_bytes / responses : 0)
+          << " bytes on average";
+      if (it->hashed > 0) {
+        out << ", " << (it->min_hash == it->max_hash ? "all" : "not all")
+            << " the same";
+      }
+      if (it->parsed > 0) {
+        out << ", " << it->parsed << " parsed, " << it->parse_errors
+            << " failed to parse";
+      }
+      out << std::endl;
+    }
+  }
+  if (stats.channels.size() > 1) {
+    for (size_t i = 0; i < stats.channels.size(); ++i) {
+      const LoadStats::Channel &channel = stats.channels[i];
+      double channel_qps =
+          stats.seconds > 0 ? channel.rpcs / stats.seconds : 0;
+      out << "\tchannel " << i << ": " << channel.rpcs << " RPCs, "
+          << channel.errors << " errors, " << channel_qps << " QPS"
+          << std::endl;
+    }
+  }
+}
+
+}  // namespace grpc
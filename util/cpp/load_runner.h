@@ -0,0 +1,354 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef UTIL_LOAD_RUNNER
+#define UTIL_LOAD_RUNNER
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <ostream>
+#include <vector>
+
+#include <google/protobuf/message.h>
+#include <grpc++/channel.h>
+#include <grpc++/client_context.h>
+#include <grpc++/completion_queue.h>
+#include <grpc++/support/async_unary_call.h>
+#include <grpc++/support/byte_buffer.h>
+#include <grpc++/support/status.h>
+
+#include "latency_histogram.h"
+
+namespace grpc {
+
+// One RPC at a time of a method, made through the async API. The load
+// runner keeps a fixed pool of these per completion queue and starts call
+// after call on each, so they double as the completion queue tags.
+class AsyncCall {
+ public:
+  virtual ~AsyncCall() {}
+
+  // Starts an RPC on cq, which reports its completion with tag.
+  virtual void Start(CompletionQueue *cq, void *tag) = 0;
+  // status of the last completed RPC
+  virtual const Status &status() const = 0;
+
+  // Gives every RPC this long from its start, zero for no deadline.
+  void set_deadline(std::chrono::nanoseconds deadline) {
+    deadline_ = deadline;
+  }
+
+ protected:
+  AsyncCall() : deadline_(0) {}
+
+  // Sets the deadline of an RPC about to start on context.
+  void SetDeadline(ClientContext *context) const {
+    if (deadline_.count() > 0) {
+      context->set_deadline(std::chrono::system_clock::now() + deadline_);
+    }
+  }
+
+ private:
+  std::chrono::nanoseconds deadline_;
+};
+
+// An AsyncCall of a unary method, sending the same request every time.
+template <class Stub, class Request, class Response>
+class AsyncUnaryCall : public AsyncCall {
+ public:
+  typedef std::unique_ptr<ClientAsyncResponseReader<Response> > (
+      Stub::*PrepareFunction)(ClientContext *, const Request &,
+                              CompletionQueue *);
+
+  AsyncUnaryCall(std::shared_ptr<Stub> stub, PrepareFunction prepare,
+                 const Request &request)
+      : stub_(stub), prepare_(prepare), request_(request) {}
+
+  void Start(CompletionQueue *cq, void *tag) override {
+    // A context only serves one RPC. Rebuild it in place rather than
+    // allocating a new one, after the reader living in its call.
+    reader_.reset();
+    context_.~ClientContext();
+    new (&context_) ClientContext();
+    SetDeadline(&context_);
+
+    reader_ = (stub_.get()->*prepare_)(&context_, request_, cq);
+    reader_->StartCall();
+    reader_->Finish(&response_, &status_, tag);
+  }
+
+  const Status &status() const override { return status_; }
+
+ private:
+  std::shared_ptr<Stub> stub_;
+  PrepareFunction prepare_;
+  Request request_;
+  Response response_;
+  Status status_;
+  ClientContext context_;
+  std::unique_ptr<ClientAsyncResponseReader<Response> > reader_;
+};
+
+// One RPC at a time of a method, made through the callback API. done runs
+// on a gRPC thread once the RPC completed, and may start the next one.
+class CallbackCall {
+ public:
+  virtual ~CallbackCall() {}
+
+  virtual void Start() = 0;
+  void set_done(std::function<void(const Status &)> done) { done_ = done; }
+  // Gives every RPC this long from its start, zero for no deadline.
+  void set_deadline(std::chrono::nanoseconds deadline) {
+    deadline_ = deadline;
+  }
+
+ protected:
+  CallbackCall() : deadline_(0) {}
+
+  // Sets the deadline of an RPC about to start on context.
+  void SetDeadline(ClientContext *context) const {
+    if (deadline_.count() > 0) {
+      context->set_deadline(std::chrono::system_clock::now() + deadline_);
+    }
+  }
+
+  std::function<void(const Status &)> done_;
+
+ private:
+  std::chrono::nanoseconds deadline_;
+};
+
+// A CallbackCall of a unary method, sending the same request every time
+// through start, which calls the method of the stub's async().
+template <class Request, class Response>
+class CallbackUnaryCall : public CallbackCall {
+ public:
+  typedef std::function<void(ClientContext *, const Request *, Response *,
+                             std::function<void(Status)>)>
+      StartFunction;
+
+  CallbackUnaryCall(StartFunction start, const Request &request)
+      : start_(start), request_(request) {}
+
+  void Start() override {
+    context_.~ClientContext();
+    new (&context_) ClientContext();
+    SetDeadline(&context_);
+    start_(&context_, &request_, &response_,
+           [this](Status status) { done_(status); });
+  }
+
+ private:
+  StartFunction start_;
+  Request request_;
+  Response response_;
+  ClientContext context_;
+};
+
+// What the generic engine needs to call a method without its generated
+// stub: a channel, the method's path, /<package>.<Service>/<Method>, and
+// its request, serialized once and shared by all the calls. response is
+// the default instance of the response type, which the sampled responses
+// are parsed into.
+struct GenericLoadCall {
+  GenericLoadCall() : response(nullptr) {}
+  GenericLoadCall(std::shared_ptr<Channel> channel, const grpc::string &path,
+                  const google::protobuf::Message &request,
+                  const google::protobuf::Message &response);
+
+  std::shared_ptr<Channel> channel;
+  grpc::string path;
+  ByteBuffer request;
+  const google::protobuf::Message *response;
+};
+
+// A method the generated prober can put under load. call makes one RPC on
+// the given context and returns its status, new_async_call and
+// new_callback_call make the calls the async and callback engines pool. A
+// method is registered once for every channel of the load, with channel
+// its index. A scenario may set the rest, see load_scenario.h.
+struct LoadMethod {
+  LoadMethod()
+      : channel(0), weight(1), max_in_flight(0), deadline_seconds(0) {}
+
+  grpc::string name;
+  int channel;
+  // With LoadOptions::weighted, how often the method is called relative to
+  // the others. Weights of the same method on several channels add up.
+  double weight;
+  // The most calls of the method, over all channels, to have in flight at
+  // once, 0 for no limit.
+  int max_in_flight;
+  // the deadline of every call from its start, 0 for none
+  double deadline_seconds;
+  std::function<Status(ClientContext *)> call;
+  std::function<std::unique_ptr<AsyncCall>()> new_async_call;
+  std::function<std::unique_ptr<CallbackCall>()> new_callback_call;
+  GenericLoadCall generic;
+};
+
+// Makes the new_callback_call of a unary method.
+template <class Request, class Response>
+std::function<std::unique_ptr<CallbackCall>()> CallbackUnaryCaller(
+    typename CallbackUnaryCall<Request, Response>::StartFunction start,
+    const Request &request) {
+  return [start, request]() {
+    return std::unique_ptr<CallbackCall>(
+        new CallbackUnaryCall<Request, Response>(start, request));
+  };
+}
+
+// Makes the new_async_call of a unary method, whose calls send request
+// through the stub's PrepareAsync function.
+template <class Stub, class Request, class Response>
+std::function<std::unique_ptr<AsyncCall>()> AsyncUnaryCaller(
+    std::shared_ptr<Stub> stub,
+    std::unique_ptr<ClientAsyncResponseReader<Response> > (Stub::*prepare)(
+        ClientContext *, const Request &, CompletionQueue *),
+    const Request &request) {
+  return [stub, prepare, request]() {
+    return std::unique_ptr<AsyncCall>(
+        new AsyncUnaryCall<Stub, Request, Response>(stub, prepare, request));
+  };
+}
+
+struct LoadOptions {
+  LoadOptions()
+      : concurrency(1),
+        duration_seconds(10),
+        max_rpcs(0),
+        async(false),
+        outstanding_rpcs(100),
+        target_qps(0),
+        poisson(false),
+        callback(false),
+        generic(false),
+        parse_sample_rate(0),
+        hash_responses(false),
+        weighted(false) {}
+
+  // number of threads, each with one RPC in flight at a time, with
+  // callback the number of RPCs in flight, or with async the number of
+  // completion queues, 0 for one per core
+  int concurrency;
+  // stop after this long, 0 for no limit
+  double duration_seconds;
+  // stop after this many RPCs, 0 for no limit
+  int64_t max_rpcs;
+  // make the RPCs through the async API, each completion queue polled by
+  // one thread and keeping outstanding_rpcs of them in flight
+  bool async;
+  int outstanding_rpcs;
+  // Send this many RPCs per second in total whatever their latency, an
+  // open loop instead of a closed one; 0 for a closed loop. Needs the async
+  // API, so implies async.
+  double target_qps;
+  // space the sends of the open loop as a Poisson process rather than
+  // evenly
+  bool poisson;
+  // make the RPCs of the closed loop through the callback API, starting the
+  // next one from the completion of the previous
+  bool callback;
+  // Make the RPCs through the generic stub, sending every method's
+  // serialized request and receiving the response without parsing it, so
+  // protobuf costs the client nothing. Works with the async and callback
+  // engines, so implies async without callback.
+  bool generic;
+  // With generic, parse this fraction of the responses into the method's
+  // response type to check them, spread evenly over the calls.
+  double parse_sample_rate;
+  // With generic, hash every response to tell whether they all were the
+  // same.
+  bool hash_responses;
+  // Pick the method of every RPC at random in proportion to the methods'
+  // weights instead of round robin.
+  bool weighted;
+};
+
+struct LoadStats {
+  struct Method {
+    grpc::string name;
+    int64_t rpcs;
+    int64_t errors;
+    LatencyHistogram latency;
+    // With generic, the bytes of the successful responses, and of the
+    // hashed ones the smallest and largest hash, equal when they were all
+    // the same.
+    int64_t response_bytes;
+    int64_t hashed;
+    uint64_t min_hash;
+    uint64_t max_hash;
+    // the sampled responses that were parsed, and those failing to parse
+    int64_t parsed;
+    int64_t parse_errors;
+  };
+  struct Channel {
+    int64_t rpcs;
+    int64_t errors;
+  };
+
+  int64_t rpcs;
+  int64_t errors;
+  double seconds;
+  // summed over the channels
+  std::vector<Method> methods;
+  // by LoadMethod::channel
+  std::vector<Channel> channels;
+};
+
+// Runs load on the methods until the duration or the RPC limit is reached.
+// Without either limit, runs for 10 seconds. By default it is a closed
+// loop: every thread calls the methods round robin, or with weighted at
+// random by weight, sending the next RPC as soon as the previous one
+// completed. A method at its max_in_flight is skipped for another one, or
+// when there is none, waited for. With callback, no thread of the
+// runner's own makes the RPCs: each one completing starts the next. With
+// async, a completion queue sends the next RPC whenever one of its
+// outstanding RPCs completed. With target_qps the loop is open: RPCs are
+// sent on schedule instead, waiting for a free call when all are in
+// flight, and latencies count from the scheduled send time so that the
+// waiting shows in them.
+LoadStats RunLoad(const std::vector<LoadMethod> &methods,
+                  const LoadOptions &options);
+
+// Prints the totals, QPS and the per-method counts and latencies, what
+// the responses of the generic engine held, and the per-channel counts and
+// QPS when there are several channels.
+void PrintLoadStats(const LoadStats &stats, std::ostream &out);
+
+}  // namespace grpc
+
+#endif  // UTIL_LOAD_RUNNER
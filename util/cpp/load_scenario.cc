@@ -0,0 +1,155 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "load_scenario.h"
+
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace grpc {
+namespace {
+
+// Parses a finite number that is not negative, all of value. strtod also
+// takes inf and nan, which would turn every weight into a NaN.
+bool ParseNumber(const grpc::string &value, double *number) {
+  if (value.empty()) return false;
+  char *end;
+  errno = 0;
+  *number = strtod(value.c_str(), &end);
+  return errno == 0 && *end == '\0' && std::isfinite(*number) &&
+         *number >= 0;
+}
+
+}  // namespace
+
+bool ReadLoadScenario(const grpc::string &path,
+                      std::vector<ScenarioMethod> *scenario,
+                      grpc::string *error)
+{
+  std::ifstream file(path);
+  if (!file) {
+    *error = "cannot read scenario " + path;
+    return false;
+  }
+  std::map<grpc::string, int> seen;
+  grpc::string line;
+  for (int number = 1; std::getline(file, line); ++number) {
+    std::ostringstream where;
+    where << path << ":" << number << ": ";
+    std::istringstream words(line.substr(0, line.find('#')));
+    ScenarioMethod method;
+    if (!(words >> method.name)) continue;
+    if (!seen.insert(std::make_pair(method.name, number)).second) {
+      std::ostringstream first;
+      first << seen[method.name];
+      *error = where.str() + method.name + " is already on line " +
+               first.str();
+      return false;
+    }
+    grpc::string setting;
+    while (words >> setting) {
+      size_t equals = setting.find('=');
+      grpc::string key = setting.substr(0, equals);
+      double value;
+      if (equals == grpc::string::npos ||
+          !ParseNumber(setting.substr(equals + 1), &value)) {
+        *error = where.str() + "expected " + key +
+                 "=<number at least 0>, not " + setting;
+        return false;
+      }
+      if (key == "weight") {
+        method.weight = value;
+      } else if (key == "max_in_flight") {
+        if (value > INT_MAX) {
+          *error = where.str() + "max_in_flight=" +
+                   setting.substr(equals + 1) + " is too large";
+          return false;
+        }
+        method.max_in_flight = static_cast<int>(value);
+      } else if (key == "deadline_ms") {
+        method.deadline_ms = value;
+      } else {
+        *error = where.str() + "unknown key " + key +
+                 ", expected weight, max_in_flight or deadline_ms";
+        return false;
+      }
+    }
+    scenario->push_back(method);
+  }
+  return true;
+}
+
+bool ApplyLoadScenario(const std::vector<ScenarioMethod> &scenario,
+                       std::vector<LoadMethod> *methods,
+                       grpc::string *error)
+{
+  std::map<grpc::string, const ScenarioMethod *> by_name;
+  bool weighted = false;
+  for (auto it = scenario.begin(); it != scenario.end(); ++it) {
+    by_name[it->name] = &*it;
+    if (it->weight > 0) weighted = true;
+  }
+  if (!weighted) {
+    *error = "the scenario gives none of the methods a weight";
+    return false;
+  }
+
+  std::vector<LoadMethod> kept;
+  std::map<grpc::string, bool> found;
+  for (auto it = methods->begin(); it != methods->end(); ++it) {
+    auto named = by_name.find(it->name);
+    if (named == by_name.end()) continue;
+    found[it->name] = true;
+    if (named->second->weight <= 0) continue;
+    kept.push_back(*it);
+    kept.back().weight = named->second->weight;
+    kept.back().max_in_flight = named->second->max_in_flight;
+    kept.back().deadline_seconds = named->second->deadline_ms / 1e3;
+  }
+  for (auto it = scenario.begin(); it != scenario.end(); ++it) {
+    if (found.count(it->name) == 0) {
+      *error = "the scenario names " + it->name +
+               ", which is not a unary method of the proto";
+      return false;
+    }
+  }
+  methods->swap(kept);
+  return true;
+}
+
+}  // namespace grpc
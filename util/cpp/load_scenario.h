@@ -0,0 +1,80 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef UTIL_LOAD_SCENARIO
+#define UTIL_LOAD_SCENARIO
+
+#include <vector>
+
+#include <grpc++/support/config.h>
+
+#include "load_runner.h"
+
+namespace grpc {
+
+// How to load one method of a scenario, a line of a scenario file:
+//
+//   # 90% cheap calls, at most 64 at once, and 10% slow ones
+//   TestService/EmptyCall weight=90 max_in_flight=64 deadline_ms=50
+//   TestService/UnaryCall weight=10 deadline_ms=500
+//
+// Every key is optional. Methods are named as in the load report, and the
+// weight is relative to the others, 1 by default.
+struct ScenarioMethod {
+  ScenarioMethod() : weight(1), max_in_flight(0), deadline_ms(0) {}
+
+  grpc::string name;
+  double weight;
+  // 0 for no limit
+  int max_in_flight;
+  // 0 for no deadline
+  double deadline_ms;
+};
+
+// Reads a scenario file, returning false with the reason in error when it
+// cannot be read or a line does not parse. Text after a # is a comment.
+bool ReadLoadScenario(const grpc::string &path,
+                      std::vector<ScenarioMethod> *scenario,
+                      grpc::string *error);
+
+// Gives the methods named by the scenario its weights, limits and
+// deadlines on every channel, and drops the others from the load. Returns
+// false with the reason in error when the scenario names a method the
+// prober cannot load, or gives none of them a weight.
+bool ApplyLoadScenario(const std::vector<ScenarioMethod> &scenario,
+                       std::vector<LoadMethod> *methods,
+                       grpc::string *error);
+
+}  // namespace grpc
+
+#endif  // UTIL_LOAD_SCENARIO
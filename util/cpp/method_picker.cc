@@ -0,0 +1,117 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "method_picker.h"
+
+#include <map>
+
+namespace grpc {
+
+const size_t MethodPicker::kNone;
+
+MethodPicker::MethodPicker(const std::vector<LoadMethod> &methods,
+                           const LoadOptions &options)
+    : size_(methods.size()), weighted_(options.weighted), limited_(false)
+{
+  std::vector<double> weights;
+  std::map<grpc::string, size_t> groups;
+  for (auto it = methods.begin(); it != methods.end(); ++it) {
+    weights.push_back(it->weight);
+    auto found = groups.insert(std::make_pair(it->name, limits_.size()));
+    if (found.second) limits_.push_back(it->max_in_flight);
+    group_.push_back(found.first->second);
+    if (it->max_in_flight > 0) limited_ = true;
+  }
+  if (weighted_) sampler_ = AliasSampler(weights);
+  in_flight_.reset(new std::atomic<int>[limits_.size()]);
+  for (size_t i = 0; i < limits_.size(); ++i) in_flight_[i] = 0;
+}
+
+MethodPicker::Cursor MethodPicker::NewCursor(int worker) const {
+  Cursor cursor;
+  cursor.next = worker % size_;
+  if (weighted_) cursor.random.seed(std::random_device()() + worker);
+  return cursor;
+}
+
+size_t MethodPicker::Pick(Cursor *cursor, size_t held) {
+  if (!limited_) return Draw(cursor);
+  const int kDraws = 8;
+  size_t method = 0;
+  for (int i = 0; i < kDraws; ++i) {
+    method = Draw(cursor);
+    if (Acquire(method, held)) return Take(method, held);
+  }
+  // Then the ones after the last draw in turn, skewed towards the methods
+  // after full ones, but only when their limits hold back the weights
+  // anyway. Each is acquired at most once, so none is counted twice.
+  for (size_t j = 0; j < size_; ++j) {
+    method = method + 1 == size_ ? 0 : method + 1;
+    if (Acquire(method, held)) return Take(method, held);
+  }
+  return held;
+}
+
+void MethodPicker::Release(size_t method) {
+  if (method == kNone || !limited_) return;
+  size_t group = group_[method];
+  if (limits_[group] > 0) {
+    in_flight_[group].fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+size_t MethodPicker::Draw(Cursor *cursor) const {
+  if (weighted_) return sampler_.Sample(cursor->random());
+  size_t method = cursor->next;
+  if (++cursor->next == size_) cursor->next = 0;
+  return method;
+}
+
+bool MethodPicker::Acquire(size_t method, size_t held) {
+  size_t group = group_[method];
+  if (limits_[group] <= 0) return true;
+  if (held != kNone && group_[held] == group) return true;
+  if (in_flight_[group].fetch_add(1, std::memory_order_relaxed) <
+      limits_[group]) {
+    return true;
+  }
+  in_flight_[group].fetch_sub(1, std::memory_order_relaxed);
+  return false;
+}
+
+size_t MethodPicker::Take(size_t method, size_t held) {
+  if (held != kNone && group_[method] != group_[held]) Release(held);
+  return method;
+}
+
+}  // namespace grpc
@@ -0,0 +1,101 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef UTIL_METHOD_PICKER
+#define UTIL_METHOD_PICKER
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "alias_sampler.h"
+#include "load_runner.h"
+
+namespace grpc {
+
+// Picks the method of every RPC for the engines of the load runner: round
+// robin, or with weighted at random through an alias table. When any
+// method has a max_in_flight, it also counts the calls in flight of every
+// method and skips those at their limit. The picker is shared, every
+// thread or pooled call picks through a Cursor of its own.
+class MethodPicker {
+ public:
+  static const size_t kNone = static_cast<size_t>(-1);
+
+  struct Cursor {
+    // the next method round robin
+    size_t next;
+    std::mt19937_64 random;
+  };
+
+  MethodPicker(const std::vector<LoadMethod> &methods,
+               const LoadOptions &options);
+
+  // The cursor of the given thread or pooled call, whose round robin
+  // starts at a method of its own to spread them over the methods.
+  Cursor NewCursor(int worker) const;
+
+  // Picks the method of the next RPC of a worker whose last RPC was of
+  // held, kNone if it has none, and counts it in flight in place of held.
+  // Draws a few times for a method under its limit, then goes through all
+  // of them. When every one is at its limit, returns held, which the
+  // worker can always go on with, or kNone.
+  size_t Pick(Cursor *cursor, size_t held);
+
+  // Counts an RPC of method, kNone for none, as no longer in flight.
+  void Release(size_t method);
+
+ private:
+  size_t Draw(Cursor *cursor) const;
+  // Counts an RPC of method in flight if under its limit. One of the
+  // method held by the worker is already counted.
+  bool Acquire(size_t method, size_t held);
+  // Hands the worker's count over from held to method, just acquired.
+  size_t Take(size_t method, size_t held);
+
+  size_t size_;
+  bool weighted_;
+  AliasSampler sampler_;
+  bool limited_;
+  // The limits count the RPCs of a method over all channels, which share
+  // its name, so they are kept by the index of the name.
+  std::vector<size_t> group_;
+  std::vector<int> limits_;
+  std::unique_ptr<std::atomic<int>[]> in_flight_;
+};
+
+}  // namespace grpc
+
+#endif  // UTIL_METHOD_PICKER
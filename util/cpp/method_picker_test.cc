@@ -0,0 +1,131 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "method_picker.h"
+
+#include <cstdlib>
+#include <iostream>
+
+namespace grpc {
+namespace {
+
+#define EXPECT(condition)                                                 \
+  do {                                                                    \
+    if (!(condition)) {                                                   \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": " #condition         \
+                << std::endl;                                             \
+      std::exit(1);                                                       \
+    }                                                                     \
+  } while (0)
+
+LoadMethod Method(const grpc::string &name, double weight,
+                  int max_in_flight) {
+  LoadMethod method;
+  method.name = name;
+  method.weight = weight;
+  method.max_in_flight = max_in_flight;
+  return method;
+}
+
+// Two methods capped at one call each, one of them drawn almost always:
+// every pick must still find the other one while it is free, and count
+// each method in flight exactly once.
+void TestCappedMethods() {
+  std::vector<LoadMethod> methods;
+  methods.push_back(Method("Heavy", 1000, 1));
+  methods.push_back(Method("Light", 1, 1));
+  LoadOptions options;
+  options.weighted = true;
+  MethodPicker picker(methods, options);
+  MethodPicker::Cursor first = picker.NewCursor(0);
+  MethodPicker::Cursor second = picker.NewCursor(1);
+  MethodPicker::Cursor third = picker.NewCursor(2);
+
+  size_t a = picker.Pick(&first, MethodPicker::kNone);
+  size_t b = picker.Pick(&second, MethodPicker::kNone);
+  EXPECT(a != MethodPicker::kNone);
+  EXPECT(b != MethodPicker::kNone);
+  EXPECT(a != b);
+  // both are in flight, so a third worker gets none, and the others keep
+  // what they hold
+  EXPECT(picker.Pick(&third, MethodPicker::kNone) == MethodPicker::kNone);
+  EXPECT(picker.Pick(&first, a) == a);
+  EXPECT(picker.Pick(&second, b) == b);
+
+  // once one is released, it is the third worker's
+  picker.Release(a);
+  EXPECT(picker.Pick(&third, MethodPicker::kNone) == a);
+  EXPECT(picker.Pick(&first, MethodPicker::kNone) == MethodPicker::kNone);
+
+  // however often Heavy is drawn, two workers picking together always get
+  // Light too once both are released
+  picker.Release(a);
+  picker.Release(b);
+  int light = 0;
+  for (int i = 0; i < 200000; ++i) {
+    size_t heavy = picker.Pick(&first, MethodPicker::kNone);
+    size_t other = picker.Pick(&second, MethodPicker::kNone);
+    EXPECT(heavy != MethodPicker::kNone && other != MethodPicker::kNone);
+    if (methods[heavy].name == "Light" || methods[other].name == "Light") {
+      ++light;
+    }
+    picker.Release(heavy);
+    picker.Release(other);
+  }
+  EXPECT(light == 200000);
+}
+
+// Without limits, round robin goes over every method from each cursor's
+// own starting point.
+void TestRoundRobin() {
+  std::vector<LoadMethod> methods;
+  methods.push_back(Method("M0", 1, 0));
+  methods.push_back(Method("M1", 1, 0));
+  methods.push_back(Method("M2", 1, 0));
+  MethodPicker picker(methods, LoadOptions());
+  MethodPicker::Cursor cursor = picker.NewCursor(1);
+  EXPECT(picker.Pick(&cursor, MethodPicker::kNone) == 1);
+  EXPECT(picker.Pick(&cursor, 1) == 2);
+  EXPECT(picker.Pick(&cursor, 2) == 0);
+  EXPECT(picker.Pick(&cursor, 0) == 1);
+}
+
+}  // namespace
+}  // namespace grpc
+
+int main() {
+  grpc::TestCappedMethods();
+  grpc::TestRoundRobin();
+  std::cout << "PASSED" << std::endl;
+  return 0;
+}
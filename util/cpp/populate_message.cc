@@ -0,0 +1,127 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "populate_message.h"
+
+#include <google/protobuf/descriptor.h>
+
+namespace grpc {
+
+using google::protobuf::Descriptor;
+using google::protobuf::FieldDescriptor;
+using google::protobuf::Message;
+using google::protobuf::Reflection;
+
+// Tables list fields in declaration order, so the next field is almost
+// always the one at *next. Falls back to the lookup by number otherwise.
+static const FieldDescriptor *FindField(const Descriptor *descriptor,
+                                        int number, int *next)
+{
+  for (int i = *next; i < descriptor->field_count(); ++i) {
+    if (descriptor->field(i)->number() == number) {
+      *next = i + 1;
+      return descriptor->field(i);
+    }
+  }
+  return descriptor->FindFieldByNumber(number);
+}
+
+static void PopulateValue(const PopulateField &entry,
+                          const FieldDescriptor *field,
+                          const Reflection *reflection, Message *message)
+{
+  bool repeated = field->is_repeated();
+  switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT32:
+      if (repeated) reflection->AddInt32(message, field, 123);
+      else reflection->SetInt32(message, field, 123);
+      break;
+    case FieldDescriptor::CPPTYPE_INT64:
+      if (repeated) reflection->AddInt64(message, field, 1234);
+      else reflection->SetInt64(message, field, 1234);
+      break;
+    case FieldDescriptor::CPPTYPE_UINT32:
+      if (repeated) reflection->AddUInt32(message, field, 123);
+      else reflection->SetUInt32(message, field, 123);
+      break;
+    case FieldDescriptor::CPPTYPE_UINT64:
+      if (repeated) reflection->AddUInt64(message, field, 1234);
+      else reflection->SetUInt64(message, field, 1234);
+      break;
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+      if (repeated) reflection->AddDouble(message, field, 1.234);
+      else reflection->SetDouble(message, field, 1.234);
+      break;
+    case FieldDescriptor::CPPTYPE_FLOAT:
+      if (repeated) reflection->AddFloat(message, field, 1.234f);
+      else reflection->SetFloat(message, field, 1.234f);
+      break;
+    case FieldDescriptor::CPPTYPE_BOOL:
+      if (repeated) reflection->AddBool(message, field, true);
+      else reflection->SetBool(message, field, true);
+      break;
+    case FieldDescriptor::CPPTYPE_STRING:
+      if (repeated) reflection->AddString(message, field, "Hello world");
+      else reflection->SetString(message, field, "Hello world");
+      break;
+    case FieldDescriptor::CPPTYPE_ENUM:
+      if (repeated) reflection->AddEnumValue(message, field, entry.sentinel);
+      else reflection->SetEnumValue(message, field, entry.sentinel);
+      break;
+    case FieldDescriptor::CPPTYPE_MESSAGE: {
+      Message *child = repeated ? reflection->AddMessage(message, field)
+                                : reflection->MutableMessage(message, field);
+      if (entry.message != nullptr) PopulateMessage(entry.message, child);
+      break;
+    }
+  }
+}
+
+void PopulateMessage(const PopulateField *table, Message *message)
+{
+  const Descriptor *descriptor = message->GetDescriptor();
+  const Reflection *reflection = message->GetReflection();
+  int next = 0;
+  for (const PopulateField *entry = table; entry->number != 0; ++entry) {
+    const FieldDescriptor *field =
+        FindField(descriptor, entry->number, &next);
+    // the table was generated from a different version of the proto
+    if (field == nullptr || field->type() != entry->type) continue;
+    int count = field->is_repeated() ? entry->repeat : 1;
+    for (int i = 0; i < count; ++i) {
+      PopulateValue(*entry, field, reflection, message);
+    }
+  }
+}
+
+}  // namespace grpc
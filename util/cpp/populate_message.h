@@ -0,0 +1,66 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef UTIL_POPULATE_MESSAGE
+#define UTIL_POPULATE_MESSAGE
+
+#include <google/protobuf/message.h>
+
+namespace grpc {
+
+// One entry of a population table generated with the populate_tables
+// option. A table lists the fields of a message to populate, in declaration
+// order, and ends with an empty entry. Trailing members are usually left
+// out of the generated initializers, so they must default to 0.
+struct PopulateField {
+  // field number, 0 ends the table
+  int number;
+  // google::protobuf::FieldDescriptor::Type of the field
+  int type;
+  // number of values added to a repeated field, ignored otherwise
+  int repeat;
+  // value set on enum fields, ignored otherwise
+  int sentinel;
+  // table used to populate message fields
+  const PopulateField *message;
+};
+
+// Populates message with the sentinel values of the generated straight-line
+// population functions, as described by table. Entries that do not match a
+// field of the message are skipped.
+void PopulateMessage(const PopulateField *table,
+                     google::protobuf::Message *message);
+
+}  // namespace grpc
+
+#endif  // UTIL_POPULATE_MESSAGE
@@ -0,0 +1,88 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "probe_runner.h"
+
+namespace grpc {
+
+ProbeRunner::ProbeRunner(int threads, std::ostream &out)
+    : out_(out), failed_(0), pool_(threads) {}
+
+void ProbeRunner::PrintLine(const grpc::string &line)
+{
+  std::lock_guard<std::mutex> lock(mu_);
+  outputs_.emplace_back(new Output);
+  outputs_.back()->text << line << std::endl;
+  outputs_.back()->done = true;
+  Flush();
+}
+
+void ProbeRunner::Add(std::function<bool(std::ostream &out)> probe)
+{
+  Output *output;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    outputs_.emplace_back(new Output);
+    output = outputs_.back().get();
+  }
+  pool_.Add([this, output, probe]() {
+    // only this probe writes to its output until it is done
+    bool passed = probe(output->text);
+    std::lock_guard<std::mutex> lock(mu_);
+    if (!passed) ++failed_;
+    output->done = true;
+    Flush();
+  });
+}
+
+void ProbeRunner::Wait()
+{
+  pool_.Wait();
+}
+
+int ProbeRunner::failed()
+{
+  std::lock_guard<std::mutex> lock(mu_);
+  return failed_;
+}
+
+void ProbeRunner::Flush()
+{
+  while (!outputs_.empty() && outputs_.front()->done) {
+    out_ << outputs_.front()->text.str();
+    outputs_.pop_front();
+  }
+  out_.flush();
+}
+
+}  // namespace grpc
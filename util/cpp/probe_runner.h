@@ -0,0 +1,94 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef UTIL_PROBE_RUNNER
+#define UTIL_PROBE_RUNNER
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+
+#include <grpc++/support/config.h>
+
+#include "work_stealing_pool.h"
+
+namespace grpc {
+
+// Runs the probes of a prober at the same time on a WorkStealingPool, so
+// that probing takes about as long as the slowest probe rather than all
+// of them together. Every probe prints into an output of its own, and the
+// outputs are printed in the order the probes were added, each as soon as
+// it and all before it are done, so the report reads as if the probes had
+// run one after another. A probe returns whether it passed, and reports
+// what failed into its output, so that a failure never cuts the report
+// short.
+class ProbeRunner {
+ public:
+  // With threads 1, runs the probes one after another.
+  ProbeRunner(int threads, std::ostream &out);
+
+  // Prints line in its place among the outputs of the probes.
+  void PrintLine(const grpc::string &line);
+  void Add(std::function<bool(std::ostream &out)> probe);
+  // Waits for every probe, and so for all of their output.
+  void Wait();
+  // the probes that did not pass, final once Wait returned
+  int failed();
+
+ private:
+  struct Output {
+    Output() : done(false) {}
+
+    std::ostringstream text;
+    bool done;
+  };
+
+  // Prints the outputs that are done, up to the first one that is not.
+  // Called with mu_ held.
+  void Flush();
+
+  std::ostream &out_;
+  std::mutex mu_;
+  // in order, those not printed yet
+  std::deque<std::unique_ptr<Output> > outputs_;
+  int failed_;
+  // last, so that its threads are joined before the outputs go
+  WorkStealingPool pool_;
+};
+
+}  // namespace grpc
+
+#endif  // UTIL_PROBE_RUNNER
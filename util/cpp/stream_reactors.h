@@ -0,0 +1,357 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef UTIL_STREAM_REACTORS
+#define UTIL_STREAM_REACTORS
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// the callback API came after the grpc++/ headers were frozen
+#include <grpcpp/support/client_callback.h>
+#include <grpc++/client_context.h>
+#include <grpc++/support/status.h>
+
+#include "stream_stats.h"
+
+namespace grpc {
+
+// Reactors running the streaming probes of probers generated for the
+// callback API. Their callbacks run on gRPC's threads while the probe waits
+// in Await for the stream to end.
+
+// The end of a stream, which the probe waits for.
+class StreamDone {
+ public:
+  StreamDone() : done_(false) {}
+
+  // Waits for the stream to end, and returns its status.
+  Status Await() {
+    std::unique_lock<std::mutex> lock(mu_);
+    finished_.wait(lock, [this]() { return done_; });
+    return status_;
+  }
+
+  void Set(const Status &status) {
+    std::lock_guard<std::mutex> lock(mu_);
+    status_ = status;
+    done_ = true;
+    finished_.notify_one();
+  }
+
+ private:
+  std::mutex mu_;
+  std::condition_variable finished_;
+  bool done_;
+  Status status_;
+};
+
+// Drains a server stream into stats. Start it once the method was called
+// with it, e.g. stub->async()->ListFeatures(&context, &request, &reactor).
+template <class Response>
+class ReadReactor : public ClientReadReactor<Response> {
+ public:
+  explicit ReadReactor(StreamStats *stats) : stats_(stats) {}
+
+  void Start() {
+    this->StartRead(&response_);
+    this->StartCall();
+  }
+
+  Status Await() { return done_.Await(); }
+
+  void OnReadDone(bool ok) override {
+    if (!ok) return;
+    stats_->Record(response_.ByteSizeLong());
+    this->StartRead(&response_);
+  }
+
+  void OnDone(const Status &status) override {
+    stats_->Finish();
+    done_.Set(status);
+  }
+
+ private:
+  StreamStats *stats_;
+  Response response_;
+  StreamDone done_;
+};
+
+// Sends request on a client stream for as long as stats wants more, with
+// the buffer hint so that the messages share frames, then half-closes it.
+// Every write counts as stalled until gRPC took it. Start it once the
+// method was called with it, e.g.
+// stub->async()->RecordRoute(&context, &response, &reactor).
+template <class Request>
+class WriteReactor : public ClientWriteReactor<Request> {
+ public:
+  WriteReactor(const Request &request, WriteStats *stats)
+      : request_(request), size_(request.ByteSizeLong()), stats_(stats) {
+    options_.set_buffer_hint();
+  }
+
+  void Start() {
+    WriteNext();
+    this->StartCall();
+  }
+
+  Status Await() { return done_.Await(); }
+
+  void OnWriteDone(bool ok) override {
+    // a failed write means the stream is over, OnDone tells how
+    if (!ok) return;
+    stats_->Record(size_, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - started_));
+    WriteNext();
+  }
+
+  void OnDone(const Status &status) override {
+    stats_->Finish();
+    done_.Set(status);
+  }
+
+ private:
+  void WriteNext() {
+    if (!stats_->More()) {
+      this->StartWritesDone();
+      return;
+    }
+    started_ = std::chrono::steady_clock::now();
+    this->StartWrite(&request_, options_);
+  }
+
+  Request request_;
+  size_t size_;
+  WriteStats *stats_;
+  WriteOptions options_;
+  std::chrono::steady_clock::time_point started_;
+  StreamDone done_;
+};
+
+// Plays ping-pong on a bidirectional stream for as long as stats wants
+// more: writes request, waits for the answer and writes the next one. Then
+// half-closes the stream and reads whatever else the server sends until it
+// ends it, counting it as extra. An answer that never comes only ends the
+// stream with the context's deadline, so give it one. Start it once the
+// method was called with it, e.g. stub->async()->RouteChat(&context,
+// &reactor).
+template <class Request, class Response>
+class PingPongReactor : public ClientBidiReactor<Request, Response> {
+ public:
+  PingPongReactor(const Request &request, PingPongStats *stats)
+      : request_(request), stats_(stats), waiting_(false) {}
+
+  void Start() {
+    Ping();
+    this->StartCall();
+  }
+
+  Status Await() { return done_.Await(); }
+
+  void OnWriteDone(bool ok) override {
+    if (!ok) return;
+    this->StartRead(&response_);
+  }
+
+  void OnReadDone(bool ok) override {
+    if (!ok) {
+      if (waiting_) stats_->Unanswered();
+      waiting_ = false;
+      return;
+    }
+    if (!waiting_) {
+      // draining after the last ping
+      stats_->Extra();
+      this->StartRead(&response_);
+      return;
+    }
+    waiting_ = false;
+    stats_->Record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - sent_));
+    Ping();
+  }
+
+  void OnDone(const Status &status) override {
+    stats_->Finish();
+    done_.Set(status);
+  }
+
+ private:
+  void Ping() {
+    if (!stats_->More()) {
+      this->StartWritesDone();
+      this->StartRead(&response_);
+      return;
+    }
+    waiting_ = true;
+    sent_ = std::chrono::steady_clock::now();
+    this->StartWrite(&request_);
+  }
+
+  Request request_;
+  Response response_;
+  PingPongStats *stats_;
+  // whether a ping is waiting for its answer
+  bool waiting_;
+  std::chrono::steady_clock::time_point sent_;
+  StreamDone done_;
+};
+
+// Keeps a bidirectional stream full in both directions: writes request
+// over and over until the deadline while reading whatever comes back, the
+// read and the write each outstanding at the same time. Then half-closes
+// the stream and reads it to the end. Start it once the method was called
+// with it, e.g. stub->async()->RouteChat(&context, &reactor).
+template <class Request, class Response>
+class DuplexReactor : public ClientBidiReactor<Request, Response> {
+ public:
+  // With a deadline of time_point::max(), writes until the server ends the
+  // stream.
+  DuplexReactor(const Request &request,
+                std::chrono::steady_clock::time_point deadline)
+      : request_(request),
+        deadline_(deadline),
+        sent_(0),
+        received_(0),
+        received_bytes_(0) {}
+
+  void Start() {
+    WriteNext();
+    this->StartRead(&response_);
+    this->StartCall();
+  }
+
+  Status Await() { return done_.Await(); }
+
+  // Only read these once Await returned.
+  int64_t sent() const { return sent_; }
+  int64_t received() const { return received_; }
+  int64_t received_bytes() const { return received_bytes_; }
+
+  // The writes and the reads run concurrently, but each only touches
+  // counters of its own.
+  void OnWriteDone(bool ok) override {
+    if (!ok) return;
+    ++sent_;
+    WriteNext();
+  }
+
+  void OnReadDone(bool ok) override {
+    if (!ok) return;
+    ++received_;
+    received_bytes_ += response_.ByteSizeLong();
+    this->StartRead(&response_);
+  }
+
+  void OnDone(const Status &status) override { done_.Set(status); }
+
+ private:
+  void WriteNext() {
+    if (std::chrono::steady_clock::now() >= deadline_) {
+      this->StartWritesDone();
+      return;
+    }
+    this->StartWrite(&request_);
+  }
+
+  Request request_;
+  Response response_;
+  std::chrono::steady_clock::time_point deadline_;
+  int64_t sent_;
+  int64_t received_;
+  int64_t received_bytes_;
+  StreamDone done_;
+};
+
+// Calls a bidirectional streaming method for stream i of a throughput probe
+// with the given context and reactor, e.g. with
+// stubs[i % stubs.size()]->async()->RouteChat(context, reactor).
+template <class Request, class Response>
+using DuplexReactorStarter = std::function<void(
+    size_t i, ClientContext *context,
+    ClientBidiReactor<Request, Response> *reactor)>;
+
+// Measures the throughput of a bidirectional streaming method through the
+// callback API, the counterpart of RunDuplexStreams: runs streams
+// DuplexReactors for seconds, or with no limit until the server ends them,
+// and waits for all of them to end.
+template <class Request, class Response>
+DuplexStats RunDuplexReactors(const Request &request, size_t streams,
+                              double seconds,
+                              DuplexReactorStarter<Request, Response> start)
+{
+  typedef std::chrono::steady_clock clock;
+  struct Stream {
+    Stream(const Request &request, clock::time_point deadline)
+        : reactor(request, deadline) {}
+
+    ClientContext context;
+    DuplexReactor<Request, Response> reactor;
+  };
+
+  DuplexStats stats;
+  clock::time_point deadline =
+      seconds > 0 ? clock::now() + std::chrono::duration_cast<clock::duration>(
+                                       std::chrono::duration<double>(seconds))
+                  : clock::time_point::max();
+  std::vector<std::unique_ptr<Stream> > all;
+  for (size_t i = 0; i < streams; ++i) {
+    all.emplace_back(new Stream(request, deadline));
+    Stream *s = all.back().get();
+    start(i, &s->context, &s->reactor);
+    s->reactor.Start();
+  }
+  std::vector<Status> statuses;
+  for (const std::unique_ptr<Stream> &s : all) {
+    statuses.push_back(s->reactor.Await());
+  }
+  stats.Finish();
+
+  int64_t size = request.ByteSizeLong();
+  for (size_t i = 0; i < all.size(); ++i) {
+    const DuplexReactor<Request, Response> &reactor = all[i]->reactor;
+    stats.Add(reactor.sent(), reactor.sent() * size, reactor.received(),
+              reactor.received_bytes(), statuses[i].ok());
+  }
+  return stats;
+}
+
+}  // namespace grpc
+
+#endif  // UTIL_STREAM_REACTORS
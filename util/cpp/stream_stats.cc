@@ -0,0 +1,243 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "stream_stats.h"
+
+namespace grpc {
+
+StreamStats::StreamStats()
+    : start_(clock::now()), end_(start_), messages_(0), bytes_(0) {}
+
+void StreamStats::Record(size_t bytes)
+{
+  clock::time_point now = clock::now();
+  if (messages_ == 0) {
+    first_ = now;
+  } else {
+    gaps_.Record(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_)
+            .count());
+  }
+  last_ = now;
+  ++messages_;
+  bytes_ += bytes;
+}
+
+void StreamStats::Finish() { end_ = clock::now(); }
+
+std::chrono::nanoseconds StreamStats::first_message() const
+{
+  if (messages_ == 0) return std::chrono::nanoseconds(0);
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(first_ -
+                                                              start_);
+}
+
+double StreamStats::seconds() const
+{
+  return std::chrono::duration<double>(end_ - start_).count();
+}
+
+void PrintStreamStats(const grpc::string &name, const StreamStats &stats,
+                      std::ostream &out)
+{
+  double seconds = stats.seconds();
+  out << "\t" << name << ": " << stats.messages() << " messages, "
+      << stats.bytes() << " bytes in " << seconds * 1e3 << "ms";
+  if (stats.messages() > 0) {
+    out << ", first after " << stats.first_message().count() / 1e6 << "ms";
+  }
+  if (seconds > 0) {
+    out << ", " << stats.messages() / seconds << " messages/s, "
+        << stats.bytes() / seconds << " bytes/s";
+  }
+  out << std::endl;
+  if (stats.gaps().count() > 0) {
+    out << "\t\tgaps ";
+    PrintLatencyPercentiles(stats.gaps(), out);
+    out << std::endl;
+  }
+}
+
+WriteStats::WriteStats(int64_t max_messages, int64_t max_bytes)
+    : max_messages_(max_messages),
+      max_bytes_(max_bytes),
+      start_(clock::now()),
+      end_(start_),
+      messages_(0),
+      bytes_(0) {}
+
+bool WriteStats::More() const
+{
+  // empty messages never add up to max_bytes, so only one is sent
+  if (max_bytes_ > 0) {
+    return bytes_ < max_bytes_ && (messages_ == 0 || bytes_ > 0);
+  }
+  return messages_ < max_messages_;
+}
+
+void WriteStats::Record(size_t bytes, std::chrono::nanoseconds stall)
+{
+  stalls_.Record(stall.count());
+  ++messages_;
+  bytes_ += bytes;
+}
+
+void WriteStats::Finish() { end_ = clock::now(); }
+
+double WriteStats::seconds() const
+{
+  return std::chrono::duration<double>(end_ - start_).count();
+}
+
+void PrintWriteStats(const grpc::string &name, const WriteStats &stats,
+                     std::ostream &out)
+{
+  double seconds = stats.seconds();
+  out << "\t" << name << ": sent " << stats.messages() << " messages, "
+      << stats.bytes() << " bytes in " << seconds * 1e3 << "ms";
+  if (seconds > 0) {
+    out << ", " << stats.messages() / seconds << " messages/s, "
+        << stats.bytes() / seconds << " bytes/s";
+  }
+  out << std::endl;
+  if (stats.stalls().count() > 0) {
+    out << "\t\twrite stalls ";
+    PrintLatencyPercentiles(stats.stalls(), out);
+    out << std::endl;
+  }
+}
+
+PingPongStats::PingPongStats(int64_t max_messages)
+    : max_messages_(max_messages),
+      start_(clock::now()),
+      end_(start_),
+      messages_(0),
+      unanswered_(0),
+      extra_(0),
+      first_(0) {}
+
+void PingPongStats::Record(std::chrono::nanoseconds round_trip)
+{
+  if (messages_ == 0) {
+    first_ = round_trip;
+  } else {
+    round_trips_.Record(round_trip.count());
+  }
+  ++messages_;
+}
+
+void PingPongStats::Finish() { end_ = clock::now(); }
+
+double PingPongStats::seconds() const
+{
+  return std::chrono::duration<double>(end_ - start_).count();
+}
+
+void PrintPingPongStats(const grpc::string &name, const PingPongStats &stats,
+                        std::ostream &out)
+{
+  if (!stats.one_to_one()) {
+    out << "\t" << name << ": does not answer one message with one, "
+        << stats.messages() << " answered, " << stats.unanswered()
+        << " unanswered, " << stats.extra() << " extra" << std::endl;
+    return;
+  }
+  out << "\t" << name << ": " << stats.messages() << " round trips in "
+      << stats.seconds() * 1e3 << "ms";
+  if (stats.messages() > 0) {
+    out << ", first " << stats.first_round_trip().count() / 1e6 << "ms";
+  }
+  out << std::endl;
+  if (stats.round_trips().count() > 0) {
+    out << "\t\tround trips ";
+    PrintLatencyPercentiles(stats.round_trips(), out);
+    out << std::endl;
+  }
+}
+
+DuplexStats::DuplexStats()
+    : start_(clock::now()),
+      end_(start_),
+      streams_(0),
+      failed_(0),
+      sent_messages_(0),
+      sent_bytes_(0),
+      received_messages_(0),
+      received_bytes_(0) {}
+
+void DuplexStats::Add(int64_t sent_messages, int64_t sent_bytes,
+                      int64_t received_messages, int64_t received_bytes,
+                      bool ok)
+{
+  ++streams_;
+  if (!ok) ++failed_;
+  sent_messages_ += sent_messages;
+  sent_bytes_ += sent_bytes;
+  received_messages_ += received_messages;
+  received_bytes_ += received_bytes;
+}
+
+void DuplexStats::Finish() { end_ = clock::now(); }
+
+double DuplexStats::seconds() const
+{
+  return std::chrono::duration<double>(end_ - start_).count();
+}
+
+void PrintDuplexStats(const grpc::string &name, const DuplexStats &stats,
+                      std::ostream &out)
+{
+  double seconds = stats.seconds();
+  out << "\t" << name << ": " << stats.streams() << " streams in "
+      << seconds * 1e3 << "ms";
+  if (stats.failed() > 0) {
+    out << ", " << stats.failed() << " failed";
+  }
+  out << std::endl;
+  out << "\t\tsent " << stats.sent_messages() << " messages, "
+      << stats.sent_bytes() << " bytes";
+  if (seconds > 0) {
+    out << ", " << stats.sent_messages() / seconds << " messages/s, "
+        << stats.sent_bytes() / seconds << " bytes/s";
+  }
+  out << std::endl;
+  out << "\t\treceived " << stats.received_messages() << " messages, "
+      << stats.received_bytes() << " bytes";
+  if (seconds > 0) {
+    out << ", " << stats.received_messages() / seconds << " messages/s, "
+        << stats.received_bytes() / seconds << " bytes/s";
+  }
+  out << std::endl;
+}
+
+}  // namespace grpc
@@ -0,0 +1,220 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef UTIL_STREAM_STATS
+#define UTIL_STREAM_STATS
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+#include <grpc++/support/config.h>
+
+#include "latency_histogram.h"
+
+namespace grpc {
+
+// What a probe saw of a stream of messages it received: how long the first
+// one took, the gaps between the following ones, and how many messages and
+// bytes came in how long.
+class StreamStats {
+ public:
+  // Starts the clock, so make it right before opening the stream.
+  StreamStats();
+
+  // Counts a message of the given size that arrived just now.
+  void Record(size_t bytes);
+  // Stops the clock once the stream has ended.
+  void Finish();
+
+  int64_t messages() const { return messages_; }
+  int64_t bytes() const { return bytes_; }
+  // from the start to the first message, zero without messages
+  std::chrono::nanoseconds first_message() const;
+  // from the start to Finish
+  double seconds() const;
+  const LatencyHistogram &gaps() const { return gaps_; }
+
+ private:
+  typedef std::chrono::steady_clock clock;
+
+  clock::time_point start_;
+  clock::time_point first_;
+  clock::time_point last_;
+  clock::time_point end_;
+  int64_t messages_;
+  int64_t bytes_;
+  LatencyHistogram gaps_;
+};
+
+// Prints the counts of a stream, its time to first message, messages and
+// bytes per second and the percentiles of the gaps between messages.
+void PrintStreamStats(const grpc::string &name, const StreamStats &stats,
+                      std::ostream &out);
+
+// What a probe saw of a stream of messages it sent: how many messages and
+// bytes went out in how long, and how long each write blocked, which is
+// mostly waiting for flow control to open the receive window.
+class WriteStats {
+ public:
+  // Starts the clock for a stream of max_messages messages, or with
+  // max_bytes set, of as many messages as it takes to send that many
+  // bytes.
+  WriteStats(int64_t max_messages, int64_t max_bytes);
+
+  // Whether the stream is to send another message.
+  bool More() const;
+  // Counts a message of the given size whose write blocked for stall.
+  void Record(size_t bytes, std::chrono::nanoseconds stall);
+  // Stops the clock once the stream has ended.
+  void Finish();
+
+  int64_t messages() const { return messages_; }
+  int64_t bytes() const { return bytes_; }
+  // from the start to Finish
+  double seconds() const;
+  const LatencyHistogram &stalls() const { return stalls_; }
+
+ private:
+  typedef std::chrono::steady_clock clock;
+
+  int64_t max_messages_;
+  int64_t max_bytes_;
+  clock::time_point start_;
+  clock::time_point end_;
+  int64_t messages_;
+  int64_t bytes_;
+  LatencyHistogram stalls_;
+};
+
+// Prints the counts of an upload, its messages and bytes per second and the
+// percentiles of the time its writes blocked.
+void PrintWriteStats(const grpc::string &name, const WriteStats &stats,
+                     std::ostream &out);
+
+// What a probe saw of a ping-pong over one stream: the round trips of the
+// messages it wrote and had answered one at a time. The first one also
+// sets the stream up, so it is kept apart from the others. A method that
+// leaves a message unanswered, or answers with more than one, is not one
+// to one, and its round trips measure nothing.
+class PingPongStats {
+ public:
+  // Starts the clock for max_messages round trips.
+  explicit PingPongStats(int64_t max_messages);
+
+  // Whether to write another message.
+  bool More() const {
+    return messages_ < max_messages_ && unanswered_ == 0;
+  }
+  // Counts a message answered round_trip after it was written.
+  void Record(std::chrono::nanoseconds round_trip);
+  // Counts a message whose answer never came, as the stream ended first.
+  void Unanswered() { ++unanswered_; }
+  // Counts a message read after the last answer, which answers nothing.
+  void Extra() { ++extra_; }
+  // Stops the clock once the stream has ended.
+  void Finish();
+
+  bool one_to_one() const { return unanswered_ == 0 && extra_ == 0; }
+  int64_t messages() const { return messages_; }
+  int64_t unanswered() const { return unanswered_; }
+  int64_t extra() const { return extra_; }
+  std::chrono::nanoseconds first_round_trip() const { return first_; }
+  // from the start to Finish
+  double seconds() const;
+  // of all messages but the first
+  const LatencyHistogram &round_trips() const { return round_trips_; }
+
+ private:
+  typedef std::chrono::steady_clock clock;
+
+  int64_t max_messages_;
+  clock::time_point start_;
+  clock::time_point end_;
+  int64_t messages_;
+  int64_t unanswered_;
+  int64_t extra_;
+  std::chrono::nanoseconds first_;
+  LatencyHistogram round_trips_;
+};
+
+// Prints the round trips of a ping-pong, the first one and the percentiles
+// of the others, or when the method is not one to one, only that.
+void PrintPingPongStats(const grpc::string &name, const PingPongStats &stats,
+                        std::ostream &out);
+
+// What a throughput probe saw of its bidirectional streams, each written
+// and read at the same time: how many messages and bytes went each way in
+// how long, and how many of the streams failed.
+class DuplexStats {
+ public:
+  // Starts the clock, so make it right before opening the streams.
+  DuplexStats();
+
+  // Adds up what one stream sent and received once it ended.
+  void Add(int64_t sent_messages, int64_t sent_bytes,
+           int64_t received_messages, int64_t received_bytes, bool ok);
+  // Stops the clock once all streams have ended.
+  void Finish();
+
+  int streams() const { return streams_; }
+  int failed() const { return failed_; }
+  int64_t sent_messages() const { return sent_messages_; }
+  int64_t sent_bytes() const { return sent_bytes_; }
+  int64_t received_messages() const { return received_messages_; }
+  int64_t received_bytes() const { return received_bytes_; }
+  // from the start to Finish
+  double seconds() const;
+
+ private:
+  typedef std::chrono::steady_clock clock;
+
+  clock::time_point start_;
+  clock::time_point end_;
+  int streams_;
+  int failed_;
+  int64_t sent_messages_;
+  int64_t sent_bytes_;
+  int64_t received_messages_;
+  int64_t received_bytes_;
+};
+
+// Prints the streams of a throughput probe and the messages and bytes per
+// second they sent and received.
+void PrintDuplexStats(const grpc::string &name, const DuplexStats &stats,
+                      std::ostream &out);
+
+}  // namespace grpc
+
+#endif  // UTIL_STREAM_STATS
@@ -0,0 +1,141 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "work_stealing_pool.h"
+
+namespace grpc {
+namespace {
+
+// the pool the current thread belongs to, and the index of its deque
+thread_local const WorkStealingPool *current_pool = nullptr;
+thread_local size_t current_queue = 0;
+
+}  // namespace
+
+WorkStealingPool::WorkStealingPool(int threads)
+    : queued_(0), unfinished_(0), next_(0), stopping_(false)
+{
+  if (threads <= 0) threads = std::thread::hardware_concurrency();
+  if (threads <= 0) threads = 1;
+  for (int i = 0; i < threads; ++i) {
+    queues_.emplace_back(new Queue);
+  }
+  for (int i = 0; i < threads; ++i) {
+    threads_.emplace_back([this, i]() { Run(i); });
+  }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (auto it = threads_.begin(); it != threads_.end(); ++it) {
+    it->join();
+  }
+}
+
+void WorkStealingPool::Add(std::function<void()> task)
+{
+  size_t queue;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (current_pool == this) {
+      queue = current_queue;
+    } else {
+      queue = next_;
+      next_ = (next_ + 1) % queues_.size();
+    }
+    ++unfinished_;
+    ++queued_;
+  }
+  {
+    std::lock_guard<std::mutex> lock(queues_[queue]->mu);
+    queues_[queue]->tasks.push_back(std::move(task));
+  }
+  wake_.notify_one();
+}
+
+void WorkStealingPool::Wait()
+{
+  std::unique_lock<std::mutex> lock(mu_);
+  idle_.wait(lock, [this]() { return unfinished_ == 0; });
+}
+
+bool WorkStealingPool::Take(size_t self, std::function<void()> *task)
+{
+  for (size_t i = 0; i < queues_.size(); ++i) {
+    Queue &queue = *queues_[(self + i) % queues_.size()];
+    std::lock_guard<std::mutex> lock(queue.mu);
+    if (queue.tasks.empty()) continue;
+    if (i == 0) {
+      *task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    } else {
+      *task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    }
+    return true;
+  }
+  return false;
+}
+
+void WorkStealingPool::Run(size_t self)
+{
+  current_pool = this;
+  current_queue = self;
+  std::function<void()> task;
+  while (true) {
+    if (Take(self, &task)) {
+      {
+        std::lock_guard<std::mutex> lock(mu_);
+        --queued_;
+      }
+      task();
+      task = nullptr;
+      std::lock_guard<std::mutex> lock(mu_);
+      if (--unfinished_ == 0) idle_.notify_all();
+      continue;
+    }
+    // Sleep until there is a task to take. A task counts as queued from
+    // just before it is pushed until just after it was taken, which at
+    // worst makes this thread look again.
+    std::unique_lock<std::mutex> lock(mu_);
+    wake_.wait(lock, [this]() { return stopping_ || queued_ > 0; });
+    if (stopping_ && queued_ == 0) return;
+  }
+}
+
+}  // namespace grpc
@@ -0,0 +1,98 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef UTIL_WORK_STEALING_POOL
+#define UTIL_WORK_STEALING_POOL
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace grpc {
+
+// A small pool of threads running tasks, every thread from a deque of its
+// own. Tasks added from outside the pool are dealt round robin to the
+// deques, and those a task adds go to the deque of its thread. A thread
+// runs its own tasks from the front, in the order they were added, and
+// once it has none left steals from the back of the others' deques, so
+// the tasks queued behind a slow one do not wait for it.
+class WorkStealingPool {
+ public:
+  // With threads 0, one thread per core.
+  explicit WorkStealingPool(int threads);
+  // Runs the tasks still queued before joining the threads.
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+  void Add(std::function<void()> task);
+  // Waits until every task added so far has run.
+  void Wait();
+
+  size_t threads() const { return threads_.size(); }
+
+ private:
+  struct Queue {
+    std::mutex mu;
+    std::deque<std::function<void()> > tasks;
+  };
+
+  void Run(size_t self);
+  // Takes a task from the front of the thread's own deque, or from the
+  // back of another one.
+  bool Take(size_t self, std::function<void()> *task);
+
+  std::vector<std::unique_ptr<Queue> > queues_;
+  std::vector<std::thread> threads_;
+
+  // guards the counts, which the threads sleep and Wait waits on
+  std::mutex mu_;
+  std::condition_variable wake_;
+  std::condition_variable idle_;
+  // tasks in the deques, and those not run to the end yet
+  size_t queued_;
+  size_t unfinished_;
+  // the deque the next task from outside goes to
+  size_t next_;
+  bool stopping_;
+};
+
+}  // namespace grpc
+
+#endif  // UTIL_WORK_STEALING_POOL
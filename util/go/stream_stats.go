@@ -0,0 +1,260 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+package streamstats
+
+import (
+  "fmt"
+  "math"
+  "sort"
+  "time"
+)
+
+// StreamStats is what a probe saw of a stream of messages it received: how
+// long the first one took, the gaps between the following ones, and how
+// many messages and bytes came in how long.
+type StreamStats struct {
+  start    time.Time
+  first    time.Time
+  last     time.Time
+  end      time.Time
+  messages int64
+  bytes    int64
+  gaps     durations
+}
+
+// Start starts the clock, so call it right before opening the stream.
+func Start() *StreamStats {
+  now := time.Now()
+  return &StreamStats{start: now, end: now}
+}
+
+// Record counts a message of the given size that arrived just now.
+func (s *StreamStats) Record(bytes int) {
+  now := time.Now()
+  if s.messages == 0 {
+    s.first = now
+  } else {
+    s.gaps = append(s.gaps, now.Sub(s.last))
+  }
+  s.last = now
+  s.messages++
+  s.bytes += int64(bytes)
+}
+
+// Finish stops the clock once the stream has ended.
+func (s *StreamStats) Finish() {
+  s.end = time.Now()
+}
+
+// Print prints the counts of the stream, its time to first message,
+// messages and bytes per second and the percentiles of the gaps between
+// messages.
+func (s *StreamStats) Print(name string) {
+  elapsed := s.end.Sub(s.start)
+  line := fmt.Sprintf("\t%s: %d messages, %d bytes in %v", name, s.messages,
+    s.bytes, elapsed)
+  if s.messages > 0 {
+    line += fmt.Sprintf(", first after %v", s.first.Sub(s.start))
+  }
+  if seconds := elapsed.Seconds(); seconds > 0 {
+    line += fmt.Sprintf(", %g messages/s, %g bytes/s",
+      float64(s.messages)/seconds, float64(s.bytes)/seconds)
+  }
+  fmt.Println(line)
+  if len(s.gaps) > 0 {
+    fmt.Println("\t\tgaps " + s.gaps.percentiles())
+  }
+}
+
+// WriteStats is what a probe saw of a stream of messages it sent: how many
+// messages and bytes went out in how long, and how long each send blocked,
+// which is mostly waiting for flow control to open the receive window.
+type WriteStats struct {
+  maxMessages int64
+  maxBytes    int64
+  start       time.Time
+  end         time.Time
+  messages    int64
+  bytes       int64
+  stalls      durations
+}
+
+// StartWrites starts the clock for a stream of maxMessages messages, or
+// with maxBytes set, of as many messages as it takes to send that many
+// bytes.
+func StartWrites(maxMessages int64, maxBytes int64) *WriteStats {
+  now := time.Now()
+  return &WriteStats{maxMessages: maxMessages, maxBytes: maxBytes,
+    start: now, end: now}
+}
+
+// More tells whether the stream is to send another message.
+func (s *WriteStats) More() bool {
+  // empty messages never add up to maxBytes, so only one is sent
+  if s.maxBytes > 0 {
+    return s.bytes < s.maxBytes && (s.messages == 0 || s.bytes > 0)
+  }
+  return s.messages < s.maxMessages
+}
+
+// Record counts a message of the given size whose send blocked for stall.
+func (s *WriteStats) Record(bytes int, stall time.Duration) {
+  s.stalls = append(s.stalls, stall)
+  s.messages++
+  s.bytes += int64(bytes)
+}
+
+// Finish stops the clock once the stream has ended.
+func (s *WriteStats) Finish() {
+  s.end = time.Now()
+}
+
+// Print prints the counts of the upload, its messages and bytes per second
+// and the percentiles of the time its sends blocked.
+func (s *WriteStats) Print(name string) {
+  elapsed := s.end.Sub(s.start)
+  line := fmt.Sprintf("\t%s: sent %d messages, %d bytes in %v", name,
+    s.messages, s.bytes, elapsed)
+  if seconds := elapsed.Seconds(); seconds > 0 {
+    line += fmt.Sprintf(", %g messages/s, %g bytes/s",
+      float64(s.messages)/seconds, float64(s.bytes)/seconds)
+  }
+  fmt.Println(line)
+  if len(s.stalls) > 0 {
+    fmt.Println("\t\twrite stalls " + s.stalls.percentiles())
+  }
+}
+
+// PingPongStats is what a probe saw of a ping-pong over one stream: the
+// round trips of the messages it sent and had answered one at a time. The
+// first one also sets the stream up, so it is kept apart from the others.
+// A method that leaves a message unanswered, or answers with more than
+// one, is not one to one, and its round trips measure nothing.
+type PingPongStats struct {
+  maxMessages int64
+  start       time.Time
+  end         time.Time
+  messages    int64
+  unanswered  int64
+  extra       int64
+  first       time.Duration
+  roundTrips  durations
+}
+
+// StartPingPong starts the clock for maxMessages round trips.
+func StartPingPong(maxMessages int64) *PingPongStats {
+  now := time.Now()
+  return &PingPongStats{maxMessages: maxMessages, start: now, end: now}
+}
+
+// More tells whether to send another message.
+func (s *PingPongStats) More() bool {
+  return s.messages < s.maxMessages && s.unanswered == 0
+}
+
+// Record counts a message answered roundTrip after it was sent.
+func (s *PingPongStats) Record(roundTrip time.Duration) {
+  if s.messages == 0 {
+    s.first = roundTrip
+  } else {
+    s.roundTrips = append(s.roundTrips, roundTrip)
+  }
+  s.messages++
+}
+
+// Unanswered counts a message whose answer never came, as the stream ended
+// first.
+func (s *PingPongStats) Unanswered() {
+  s.unanswered++
+}
+
+// Extra counts a message received after the last answer, which answers
+// nothing.
+func (s *PingPongStats) Extra() {
+  s.extra++
+}
+
+// OneToOne tells whether every message had exactly one answer.
+func (s *PingPongStats) OneToOne() bool {
+  return s.unanswered == 0 && s.extra == 0
+}
+
+// Finish stops the clock once the stream has ended.
+func (s *PingPongStats) Finish() {
+  s.end = time.Now()
+}
+
+// Print prints the round trips of the ping-pong, the first one and the
+// percentiles of the others, or when the method is not one to one, only
+// that.
+func (s *PingPongStats) Print(name string) {
+  if !s.OneToOne() {
+    fmt.Printf("\t%s: does not answer one message with one, %d answered, "+
+      "%d unanswered, %d extra\n", name, s.messages, s.unanswered, s.extra)
+    return
+  }
+  line := fmt.Sprintf("\t%s: %d round trips in %v", name, s.messages,
+    s.end.Sub(s.start))
+  if s.messages > 0 {
+    line += fmt.Sprintf(", first %v", s.first)
+  }
+  fmt.Println(line)
+  if len(s.roundTrips) > 0 {
+    fmt.Println("\t\tround trips " + s.roundTrips.percentiles())
+  }
+}
+
+type durations []time.Duration
+
+func (d durations) Len() int           { return len(d) }
+func (d durations) Less(i, j int) bool { return d[i] < d[j] }
+func (d durations) Swap(i, j int)      { d[i], d[j] = d[j], d[i] }
+
+// the smallest of the sorted durations that the given fraction of them are
+// at or below
+func (d durations) percentile(quantile float64) time.Duration {
+  i := int(math.Ceil(quantile*float64(len(d)))) - 1
+  if i < 0 {
+    i = 0
+  }
+  return d[i]
+}
+
+// the p50, p90, p99, p99.9 and max of the durations, sorting them
+func (d durations) percentiles() string {
+  sort.Sort(d)
+  return fmt.Sprintf("p50 %v p90 %v p99 %v p99.9 %v max %v",
+    d.percentile(0.5), d.percentile(0.9), d.percentile(0.99),
+    d.percentile(0.999), d[len(d)-1])
+}
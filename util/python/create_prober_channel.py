@@ -62,8 +62,37 @@ def _args():
         default="foo.test.google.fr",
         help='the server host to which to claim to connect',
         type=str)
+    parser.add_argument(
+        '--stream_messages',
+        help='messages each client-streaming probe sends, unless '
+             '--stream_bytes is set, and round trips of each bidirectional '
+             'streaming probe',
+        default=10,
+        type=int)
+    parser.add_argument(
+        '--stream_bytes',
+        help='bytes each client-streaming probe sends, in whole messages; '
+             '0 sends --stream_messages messages instead',
+        default=0,
+        type=int)
+    parser.add_argument(
+        '--stream_deadline_ms',
+        help='deadline of the stream of each bidirectional streaming probe, '
+             '0 for none; a method leaving a message unanswered fails once '
+             'it passed',
+        default=10000,
+        type=int)
     return parser.parse_args()
 
+_parsed_args = None
+
+def prober_args():
+  """The command line of the prober, parsed on first use."""
+  global _parsed_args
+  if _parsed_args is None:
+    _parsed_args = _args()
+  return _parsed_args
+
 def test_root_certificates():
     return pkg_resources.resource_string(__name__,
                                          _ROOT_CERTIFICATES_RESOURCE_PATH)
@@ -76,7 +105,7 @@ def parse_bool(value):
     raise argparse.ArgumentTypeError('Only true/false allowed')
 
 def create_prober_channel():
-  args = _args()
+  args = prober_args()
   print(args)
   target = '{}:{}'.format(args.server_host, args.server_port)
   call_credentials = None
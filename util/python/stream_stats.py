@@ -0,0 +1,269 @@
+# Copyright 2017, Google Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met:
+#
+#     * Redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above
+# copyright notice, this list of conditions and the following disclaimer
+# in the documentation and/or other materials provided with the
+# distribution.
+#     * Neither the name of Google Inc. nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+"""What a probe saw of the streams of messages it received and sent."""
+
+from __future__ import division
+from __future__ import print_function
+
+import math
+import threading
+import timeit
+
+import grpc
+
+_now = timeit.default_timer
+
+
+class StreamStats(object):
+  """How long the first message of a stream took, the gaps between the
+  following ones, and how many messages and bytes came in how long.
+
+  Make it right before opening the stream, as it starts the clock.
+  """
+
+  def __init__(self):
+    self._start = _now()
+    self._first = None
+    self._last = None
+    self._end = self._start
+    self.messages = 0
+    self.bytes = 0
+    self._gaps = []
+
+  def record(self, size):
+    """Counts a message of the given size that arrived just now."""
+    now = _now()
+    if self.messages == 0:
+      self._first = now
+    else:
+      self._gaps.append(now - self._last)
+    self._last = now
+    self.messages += 1
+    self.bytes += size
+
+  def finish(self):
+    """Stops the clock once the stream has ended."""
+    self._end = _now()
+
+  def report(self, name):
+    """Prints the counts of the stream, its time to first message, messages
+    and bytes per second and the percentiles of the gaps between messages.
+    """
+    seconds = self._end - self._start
+    line = '\t{}: {} messages, {} bytes in {:.3f}ms'.format(
+        name, self.messages, self.bytes, seconds * 1e3)
+    if self.messages > 0:
+      line += ', first after {:.3f}ms'.format((self._first - self._start) * 1e3)
+    if seconds > 0:
+      line += ', {:g} messages/s, {:g} bytes/s'.format(
+          self.messages / seconds, self.bytes / seconds)
+    print(line)
+    if self._gaps:
+      print('\t\tgaps ' + _percentiles(self._gaps))
+
+
+class WriteStats(object):
+  """How many messages and bytes a stream sent in how long, and how long each
+  one waited to be taken by gRPC, which is mostly waiting for flow control to
+  open the receive window.
+
+  Sends max_messages messages, or with max_bytes set, as many as it takes to
+  send that many bytes. Make it right before opening the stream, as it
+  starts the clock.
+  """
+
+  def __init__(self, max_messages, max_bytes):
+    self._max_messages = max_messages
+    self._max_bytes = max_bytes
+    self._start = _now()
+    self._end = self._start
+    self.messages = 0
+    self.bytes = 0
+    self._stalls = []
+
+  def more(self):
+    """Whether the stream is to send another message."""
+    # empty messages never add up to max_bytes, so only one is sent
+    if self._max_bytes > 0:
+      return self.bytes < self._max_bytes and (
+          self.messages == 0 or self.bytes > 0)
+    return self.messages < self._max_messages
+
+  def record(self, size, stall):
+    """Counts a message of the given size that waited stall seconds."""
+    self._stalls.append(stall)
+    self.messages += 1
+    self.bytes += size
+
+  def send(self, request):
+    """The requests to call the method with, request over and over, timing
+    how long gRPC takes to come back for the next one."""
+    size = request.ByteSize()
+    while self.more():
+      start = _now()
+      yield request
+      self.record(size, _now() - start)
+
+  def finish(self):
+    """Stops the clock once the stream has ended."""
+    self._end = _now()
+
+  def report(self, name):
+    """Prints the counts of the upload, its messages and bytes per second and
+    the percentiles of the time its messages waited.
+    """
+    seconds = self._end - self._start
+    line = '\t{}: sent {} messages, {} bytes in {:.3f}ms'.format(
+        name, self.messages, self.bytes, seconds * 1e3)
+    if seconds > 0:
+      line += ', {:g} messages/s, {:g} bytes/s'.format(
+          self.messages / seconds, self.bytes / seconds)
+    print(line)
+    if self._stalls:
+      print('\t\twrite stalls ' + _percentiles(self._stalls))
+
+
+class PingPongStats(object):
+  """The round trips of max_messages messages sent on one stream and
+  answered one at a time. The first one also sets the stream up, so it is
+  kept apart from the others. A method that leaves a message unanswered, or
+  answers with more than one, is not one to one, and its round trips
+  measure nothing.
+
+  Make it right before opening the stream, as it starts the clock.
+  """
+
+  def __init__(self, max_messages):
+    self._max_messages = max_messages
+    self._start = _now()
+    self._end = self._start
+    self.messages = 0
+    self.unanswered = 0
+    self.extra = 0
+    self._first = None
+    self._round_trips = []
+    self._error = None
+
+  def more(self):
+    """Whether to send another message."""
+    return self.messages < self._max_messages and self.unanswered == 0
+
+  def one_to_one(self):
+    """Whether every message had exactly one answer."""
+    return self.unanswered == 0 and self.extra == 0
+
+  def record(self, round_trip):
+    """Counts a message answered round_trip seconds after it was sent."""
+    if self.messages == 0:
+      self._first = round_trip
+    else:
+      self._round_trips.append(round_trip)
+    self.messages += 1
+
+  def play(self, call, request, timeout=None):
+    """Calls the bidirectional method call with request, sending it again
+    each time the previous one was answered, and reads the answers until the
+    server ends the stream. What comes when no message waits for its answer
+    counts as extra. An answer that never comes only ends the stream with
+    its timeout in seconds, so give it one.
+    """
+    answered = threading.Semaphore(0)
+    # when the ping waiting for its answer was sent, if one is
+    sent = [None]
+
+    def requests():
+      # gRPC takes the requests from a thread of its own
+      while self.more():
+        sent[0] = _now()
+        yield request
+        answered.acquire()
+
+    try:
+      for _ in call(requests(), timeout=timeout):
+        if sent[0] is not None:
+          self.record(_now() - sent[0])
+          sent[0] = None
+          answered.release()
+        else:
+          self.extra += 1
+    except grpc.RpcError as error:
+      self._error = error
+    finally:
+      if sent[0] is not None:
+        self.unanswered += 1
+      # let the requests end if the stream ended first
+      self._max_messages = 0
+      answered.release()
+
+  def finish(self):
+    """Stops the clock once the stream has ended."""
+    self._end = _now()
+
+  def report(self, name):
+    """Prints the round trips of the ping-pong, the first one and the
+    percentiles of the others, or when the method is not one to one, only
+    that.
+    """
+    if not self.one_to_one():
+      print('\t{}: does not answer one message with one, {} answered, '
+            '{} unanswered, {} extra'.format(
+                name, self.messages, self.unanswered, self.extra))
+      return
+    line = '\t{}: {} round trips in {:.3f}ms'.format(
+        name, self.messages, (self._end - self._start) * 1e3)
+    if self._first is not None:
+      line += ', first {:.3f}ms'.format(self._first * 1e3)
+    print(line)
+    if self._round_trips:
+      print('\t\tround trips ' + _percentiles(self._round_trips))
+
+  def check(self, name):
+    """Raises the error that ended the stream, or an error if the method is
+    not one to one. Call it after the report.
+    """
+    if self._error is not None:
+      raise self._error
+    if not self.one_to_one():
+      raise RuntimeError(name + ' does not answer one message with one')
+
+
+def _percentiles(durations):
+  """The p50, p90, p99, p99.9 and max of durations in seconds."""
+  durations = sorted(durations)
+  return ' '.join(
+      '{} {:.3f}ms'.format(label, _percentile(durations, quantile) * 1e3)
+      for label, quantile in (('p50', 0.5), ('p90', 0.9), ('p99', 0.99),
+                              ('p99.9', 0.999), ('max', 1)))
+
+
+def _percentile(durations, quantile):
+  """The smallest of the sorted durations that the fraction quantile of them
+  are at or below."""
+  return durations[max(int(math.ceil(quantile * len(durations))) - 1, 0)]
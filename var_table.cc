@@ -0,0 +1,104 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "var_table.h"
+
+#include <cstring>
+
+size_t VarTable::Intern(const char *key)
+{
+  // literals are usually shared, so try the cheap pointer compare first
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    if (slots_[i].key == key) return i;
+  }
+  size_t length = strlen(key);
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    if (slots_[i].key_length == length &&
+        memcmp(slots_[i].key, key, length) == 0) {
+      return i;
+    }
+  }
+  Slot slot;
+  slot.key = key;
+  slot.key_length = length;
+  slot.bound = false;
+  slot.depth = 0;
+  slots_.push_back(std::move(slot));
+  return slots_.size() - 1;
+}
+
+grpc::string &VarTable::operator[](const char *key)
+{
+  size_t index = Intern(key);
+  Slot &slot = slots_[index];
+  if (slot.depth < depth_) {
+    // first write to this slot in the innermost scope, remember the old value
+    if (saved_ == undo_.size()) undo_.emplace_back();
+    Saved &saved = undo_[saved_++];
+    saved.slot = index;
+    saved.value.assign(slot.value);
+    saved.bound = slot.bound;
+    saved.depth = slot.depth;
+    slot.depth = depth_;
+  }
+  slot.bound = true;
+  return slot.value;
+}
+
+const grpc::string *VarTable::Find(const char *key, size_t length) const
+{
+  for (auto it = slots_.begin(); it != slots_.end(); ++it) {
+    if (it->key_length == length && memcmp(it->key, key, length) == 0) {
+      return it->bound ? &it->value : nullptr;
+    }
+  }
+  return nullptr;
+}
+
+VarTable::Scope::Scope(VarTable &vars) : vars_(vars), mark_(vars.saved_)
+{
+  ++vars_.depth_;
+}
+
+VarTable::Scope::~Scope()
+{
+  while (vars_.saved_ > mark_) {
+    Saved &saved = vars_.undo_[--vars_.saved_];
+    Slot &slot = vars_.slots_[saved.slot];
+    // swap rather than copy so both strings keep their capacity
+    slot.value.swap(saved.value);
+    slot.bound = saved.bound;
+    slot.depth = saved.depth;
+  }
+  --vars_.depth_;
+}
@@ -0,0 +1,108 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Flat table of template variables used by the generator's Printer.
+ *
+ * Keys are interned into slots the first time they are bound, and a slot
+ * keeps its storage for the lifetime of the table: the slots live in a
+ * deque, so binding new keys never moves them, and a reference returned by
+ * operator[] stays valid. Rebinding a key therefore reuses the string that
+ * is already there instead of allocating, and helpers that need temporary
+ * bindings open a Scope instead of copying the table.
+ */
+
+#ifndef SRC_GENERATOR_VAR_TABLE_H
+#define SRC_GENERATOR_VAR_TABLE_H
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+#include "config.h"
+
+class VarTable {
+ public:
+  VarTable() : saved_(0), depth_(0) {}
+
+  // Returns the value of key for assignment, binding the key if needed.
+  // key must outlive the table; in practice it is always a string literal.
+  grpc::string &operator[](const char *key);
+
+  // Returns the value bound to the key [key, key + length), or nullptr if
+  // the key has never been bound or its binding has been undone.
+  const grpc::string *Find(const char *key, size_t length) const;
+
+  // Every binding made while a Scope is alive is restored to its previous
+  // value (or unbound) when the Scope is destroyed. Scopes nest.
+  class Scope {
+   public:
+    explicit Scope(VarTable &vars);
+    ~Scope();
+
+   private:
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+    VarTable &vars_;
+    size_t mark_;
+  };
+
+ private:
+  struct Slot {
+    const char *key;
+    size_t key_length;
+    grpc::string value;
+    bool bound;
+    // innermost scope that has already saved this slot's previous value
+    int depth;
+  };
+
+  struct Saved {
+    size_t slot;
+    grpc::string value;
+    bool bound;
+    int depth;
+  };
+
+  // the index of key's slot
+  size_t Intern(const char *key);
+
+  std::deque<Slot> slots_;
+  // undo log of the open scopes. Only the first saved_ entries are live, the
+  // rest are kept around so their strings can be reused.
+  std::vector<Saved> undo_;
+  size_t saved_;
+  int depth_;
+};
+
+#endif  // SRC_GENERATOR_VAR_TABLE_H
@@ -0,0 +1,140 @@
+/*
+ *
+ * Copyright 2017, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "var_table.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+#define EXPECT(condition)                                                 \
+  do {                                                                    \
+    if (!(condition)) {                                                   \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": " #condition         \
+                << std::endl;                                             \
+      std::exit(1);                                                       \
+    }                                                                     \
+  } while (0)
+
+const grpc::string *Find(const VarTable &vars, const char *key) {
+  return vars.Find(key, strlen(key));
+}
+
+bool Bound(const VarTable &vars, const char *key, const char *value) {
+  const grpc::string *found = Find(vars, key);
+  return found != nullptr && *found == value;
+}
+
+// References handed out earlier stay valid however many keys are bound
+// after them.
+void TestReferencesStayValid() {
+  VarTable vars;
+  grpc::string &first = vars["first"];
+  first = "1";
+  // keys of their own, not shared literals
+  std::vector<grpc::string> keys;
+  for (int i = 0; i < 1000; ++i) keys.push_back("key" + std::to_string(i));
+  for (size_t i = 0; i < keys.size(); ++i) vars[keys[i].c_str()] = "x";
+  first += "2";
+  EXPECT(Bound(vars, "first", "12"));
+
+  vars["b"] = "b";
+  vars["a"] = vars["b"];
+  EXPECT(Bound(vars, "a", "b"));
+}
+
+// Leaving a scope restores what it rebound and unbinds what it bound first.
+void TestScopeRestores() {
+  VarTable vars;
+  vars["outer"] = "outer";
+  {
+    VarTable::Scope scope(vars);
+    vars["outer"] = "inner";
+    vars["new"] = "new";
+    // rebinding again in the same scope keeps the value from before it
+    vars["outer"] = "again";
+    EXPECT(Bound(vars, "outer", "again"));
+    EXPECT(Bound(vars, "new", "new"));
+  }
+  EXPECT(Bound(vars, "outer", "outer"));
+  EXPECT(Find(vars, "new") == nullptr);
+  EXPECT(Find(vars, "never") == nullptr);
+
+  // an unbound key can be bound again after its scope
+  vars["new"] = "later";
+  EXPECT(Bound(vars, "new", "later"));
+}
+
+// Every scope restores the values of its own entry.
+void TestNestedScopes() {
+  VarTable vars;
+  vars["key"] = "0";
+  {
+    VarTable::Scope one(vars);
+    vars["key"] = "1";
+    vars["one"] = "1";
+    {
+      VarTable::Scope two(vars);
+      vars["key"] = "2";
+      vars["one"] = "2";
+      vars["two"] = "2";
+      EXPECT(Bound(vars, "key", "2"));
+    }
+    EXPECT(Bound(vars, "key", "1"));
+    EXPECT(Bound(vars, "one", "1"));
+    EXPECT(Find(vars, "two") == nullptr);
+    {
+      // a second inner scope after the first one closed
+      VarTable::Scope three(vars);
+      vars["two"] = "3";
+      EXPECT(Bound(vars, "two", "3"));
+    }
+    EXPECT(Find(vars, "two") == nullptr);
+    vars["key"] = "1b";
+  }
+  EXPECT(Bound(vars, "key", "0"));
+  EXPECT(Find(vars, "one") == nullptr);
+  EXPECT(Find(vars, "two") == nullptr);
+}
+
+}  // namespace
+
+int main() {
+  TestReferencesStayValid();
+  TestScopeRestores();
+  TestNestedScopes();
+  std::cout << "PASSED" << std::endl;
+  return 0;
+}